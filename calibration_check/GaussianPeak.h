@@ -0,0 +1,202 @@
+// GaussianPeak.h
+// Mean and sigma (with uncertainties) of a Gaussian peak from the binned contents of a window,
+// for the per-run QC metrics of hodo_calib_qc_batch.
+//
+//   Caruana : weighted least squares of ln(y) = a + b x + c x^2 over the window's bins above 10%
+//             of the maximum (weights y, i.e. Poisson errors on ln y); closed form, no minimizer.
+//   Moments : iterative truncated moments in mean +- K sigma (clipped to the window), corrected
+//             for the truncation and the bin width.
+//   Fit     : Minuit "gaus" fit of the window (TH1::Fit, "QNR"), as before; kept as a cross-check.
+//
+// The closed-form estimators only read the bin contents (no TF1, no global state), so they are
+// thread-safe; EstimatePeaks() runs one of them over many histograms at once.
+#ifndef GAUSSIAN_PEAK_H
+#define GAUSSIAN_PEAK_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <TF1.h>
+#include <TH1D.h>
+#include <TMath.h>
+#include <TString.h>
+
+enum class PeakMethod { Caruana, Moments, Fit };
+
+// Peak search range in x (e.g. a few sigma around the maximum bin)
+struct PeakWindow {
+  double Lo = 0.0;
+  double Hi = 0.0;
+};
+
+struct PeakEstimate {
+  bool   Ok = false;
+  double Amplitude = std::nan(""); // height of the Gaussian (counts per bin)
+  double Mean = std::nan(""), MeanErr = std::nan("");
+  double Sigma = std::nan(""), SigmaErr = std::nan("");
+};
+
+inline const char *PeakMethodName(PeakMethod Method) {
+  if (Method == PeakMethod::Caruana) return "caruana";
+  if (Method == PeakMethod::Moments) return "moments";
+  return "fit";
+}
+
+// "fast"/"caruana", "moments" or "fit"; a "+fit" suffix asks for the Minuit cross-check
+inline bool ParsePeakMethod(const TString &Mode, PeakMethod &Method, bool &CrossCheck) {
+  TString M(Mode);
+  M.ToLower();
+  CrossCheck = M.EndsWith("+fit");
+  if (CrossCheck) M.Resize(M.Length() - 4);
+  if (M == "fast" || M == "caruana") { Method = PeakMethod::Caruana; return true; }
+  if (M == "moments")                { Method = PeakMethod::Moments; return true; }
+  if (M == "fit")                    { Method = PeakMethod::Fit; CrossCheck = false; return true; }
+  return false;
+}
+
+//--------------------------------------------------
+// CaruanaPeak: X = bin centers, Y = contents, N bins of width BinWidth, X0 = reference x (e.g.
+//   the maximum bin). Bins below MinFraction of the maximum are left out: the tails carry the
+//   background and pull the parabola open.
+//--------------------------------------------------
+inline PeakEstimate CaruanaPeak(const double *X, const double *Y, int N, double X0, double BinWidth,
+                                double MinFraction = 0.1) {
+  PeakEstimate P;
+  double YMax = 0;
+  for (int i = 0; i < N; ++i) YMax = std::max(YMax, Y[i]);
+  const double YMin = std::max(MinFraction * YMax, 0.0);
+
+  // Weighted sums of u^k (u = x - X0) and of u^k ln(y), weight y
+  double S0 = 0, S1 = 0, S2 = 0, S3 = 0, S4 = 0, T0 = 0, T1 = 0, T2 = 0;
+  int NUsed = 0;
+  for (int i = 0; i < N; ++i) {
+    const bool Use = Y[i] > 0 && Y[i] >= YMin;
+    const double W = Use ? Y[i] : 0.0;
+    const double L = Use ? std::log(Y[i]) : 0.0;
+    const double U = X[i] - X0, U2 = U * U;
+    S0 += W;          S1 += W * U;      S2 += W * U2;
+    S3 += W * U2 * U; S4 += W * U2 * U2;
+    T0 += W * L;      T1 += W * U * L;  T2 += W * U2 * L;
+    NUsed += Use;
+  }
+  if (NUsed < 3) return P;
+
+  // Normal equations [[S0,S1,S2],[S1,S2,S3],[S2,S3,S4]] (a,b,c) = (T0,T1,T2); inverse = covariance
+  const double C00 = S2 * S4 - S3 * S3, C01 = S2 * S3 - S1 * S4, C02 = S1 * S3 - S2 * S2;
+  const double C11 = S0 * S4 - S2 * S2, C12 = S1 * S2 - S0 * S3, C22 = S0 * S2 - S1 * S1;
+  const double Det = S0 * C00 + S1 * C01 + S2 * C02;
+  if (!(Det > 0)) return P;
+  const double A = (C00 * T0 + C01 * T1 + C02 * T2) / Det;
+  const double B = (C01 * T0 + C11 * T1 + C12 * T2) / Det;
+  const double C = (C02 * T0 + C12 * T1 + C22 * T2) / Det;
+  if (!(C < 0)) return P; // not a peak
+
+  const double Vbb = C11 / Det, Vbc = C12 / Det, Vcc = C22 / Det;
+  const double DMuDb = -1.0 / (2 * C), DMuDc = B / (2 * C * C);
+  const double SigmaBinned = std::sqrt(-1.0 / (2 * C));
+  P.Mean      = X0 - B / (2 * C);
+  P.Sigma     = std::sqrt(std::max(0.0, SigmaBinned * SigmaBinned - BinWidth * BinWidth / 12.0)); // Sheppard's correction
+  P.Amplitude = std::exp(A - B * B / (4 * C));
+  P.MeanErr   = std::sqrt(std::max(0.0, DMuDb * DMuDb * Vbb + DMuDc * DMuDc * Vcc + 2 * DMuDb * DMuDc * Vbc));
+  P.SigmaErr  = std::pow(SigmaBinned, 3) * std::sqrt(std::max(0.0, Vcc)); // d sigma / dc = sigma^3
+  P.Ok = (P.Sigma > 0 && P.Mean >= X[0] && P.Mean <= X[N - 1]);
+  return P;
+}
+
+// Helper: variance of a unit Gaussian truncated to [-K, K]
+inline double TruncatedGaussVariance(double K) {
+  const double Inside = std::erf(K / std::sqrt(2.0));
+  if (Inside <= 0) return 0.0;
+  return 1.0 - 2.0 * K * TMath::Gaus(K, 0.0, 1.0, kTRUE) / Inside;
+}
+
+//--------------------------------------------------
+// TruncatedMomentsPeak: X = bin centers, Y = contents, N bins of width BinWidth
+//   Moments in mean +- K sigma, iterated until mean and sigma settle (at most MaxIter times)
+//--------------------------------------------------
+inline PeakEstimate TruncatedMomentsPeak(const double *X, const double *Y, int N, double BinWidth,
+                                         double K = 2.5, int MaxIter = 20) {
+  PeakEstimate P;
+  if (N < 3) return P;
+  double Lo = X[0], Hi = X[N - 1];
+  double Mean = 0, Sigma = 0, VarObs = 0, Sum = 0, KEff = 0;
+  for (int It = 0; It < MaxIter; ++It) {
+    double S0 = 0, S1 = 0, S2 = 0;
+    for (int i = 0; i < N; ++i) {
+      const double W = (Y[i] > 0 && X[i] >= Lo && X[i] <= Hi) ? Y[i] : 0.0;
+      S0 += W; S1 += W * X[i]; S2 += W * X[i] * X[i];
+    }
+    if (S0 <= 0) return P;
+    const double M = S1 / S0;
+    VarObs = std::max(0.0, S2 / S0 - M * M - BinWidth * BinWidth / 12.0); // Sheppard's correction
+    // Truncation at the (clipped) distance of the nearer edge, in sigma of the previous step
+    KEff = (It == 0 || Sigma <= 0) ? 0.0 : std::min(M - Lo, Hi - M) / Sigma;
+    const double R = (KEff > 0) ? TruncatedGaussVariance(KEff) : 1.0;
+    const double S = (R > 0) ? std::sqrt(VarObs / R) : 0.0;
+    if (!(S > 0)) return P;
+    const bool Settled = It > 0 && std::fabs(M - Mean) < 1e-6 * S && std::fabs(S - Sigma) < 1e-6 * S;
+    Mean = M; Sigma = S; Sum = S0;
+    if (Settled) break;
+    Lo = std::max(X[0], Mean - K * Sigma);
+    Hi = std::min(X[N - 1], Mean + K * Sigma);
+  }
+  const double Inside = (KEff > 0) ? std::erf(KEff / std::sqrt(2.0)) : 1.0;
+  P.Mean      = Mean;
+  P.Sigma     = Sigma;
+  P.MeanErr   = std::sqrt(VarObs / Sum);
+  P.SigmaErr  = Sigma / std::sqrt(2.0 * Sum);
+  P.Amplitude = Sum * BinWidth / (Sigma * std::sqrt(2.0 * TMath::Pi()) * Inside);
+  P.Ok = true;
+  return P;
+}
+
+//--------------------------------------------------
+// FitPeak: Minuit "gaus" fit of H in the window (not thread-safe: TF1/TH1::Fit)
+//--------------------------------------------------
+inline PeakEstimate FitPeak(TH1D *H, const PeakWindow &W) {
+  PeakEstimate P;
+  TF1 G("G","gaus", W.Lo, W.Hi);
+  if (H->Fit(&G, "QNR") != 0) return P;
+  P.Amplitude = G.GetParameter(0);
+  P.Mean      = G.GetParameter(1);  P.MeanErr  = G.GetParError(1);
+  P.Sigma     = G.GetParameter(2);  P.SigmaErr = G.GetParError(2);
+  P.Ok = true;
+  return P;
+}
+
+//--------------------------------------------------
+// EstimatePeak: Gaussian peak of H in the window. Caruana falls back to the truncated moments
+//   when the log-parabola has no maximum (e.g. a flat or one-bin peak).
+//--------------------------------------------------
+inline PeakEstimate EstimatePeak(TH1D *H, const PeakWindow &W, PeakMethod Method) {
+  if (!H) return PeakEstimate();
+  if (Method == PeakMethod::Fit) return FitPeak(H, W);
+
+  const TAxis *Ax = H->GetXaxis();
+  const int First = Ax->FindFixBin(W.Lo), Last = Ax->FindFixBin(W.Hi);
+  std::vector<double> X, Y;
+  X.reserve(Last - First + 1); Y.reserve(Last - First + 1);
+  int MaxI = -1;
+  for (int b = std::max(First, 1); b <= std::min(Last, H->GetNbinsX()); ++b) {
+    X.push_back(Ax->GetBinCenter(b));
+    Y.push_back(H->GetBinContent(b));
+    if (MaxI < 0 || Y.back() > Y[MaxI]) MaxI = (int)Y.size() - 1;
+  }
+  if (MaxI < 0) return PeakEstimate();
+
+  if (Method == PeakMethod::Caruana) {
+    PeakEstimate P = CaruanaPeak(X.data(), Y.data(), (int)X.size(), X[MaxI], Ax->GetBinWidth(First));
+    if (P.Ok) return P;
+  }
+  return TruncatedMomentsPeak(X.data(), Y.data(), (int)X.size(), Ax->GetBinWidth(First));
+}
+
+// Peaks of many histograms at once (H[i] in window W[i]); one result per histogram
+inline std::vector<PeakEstimate> EstimatePeaks(const std::vector<TH1D*> &H, const std::vector<PeakWindow> &W,
+                                               PeakMethod Method) {
+  std::vector<PeakEstimate> Out(H.size());
+  for (size_t i = 0; i < H.size(); ++i) Out[i] = EstimatePeak(H[i], W[i], Method);
+  return Out;
+}
+
+#endif // GAUSSIAN_PEAK_H
@@ -0,0 +1,127 @@
+// QCTrendStore.h
+// Per-run QC metrics of hodo_calib_qc_batch kept in a CSV file, so a new invocation only
+// processes runs that are new or whose ROOT file (or cuts) changed, and redraws the trends
+// from the stored metrics.
+//
+// Key   : Spec ("hms"/"shms"/"coin") and run number.
+// Valid : while the run's ROOT file keeps its mtime and size, and the Spec cuts are unchanged.
+// File  : ./QC_TRENDS/qc_trends.csv, one line per (Spec, run); numbers with %.17g.
+#ifndef QC_TREND_STORE_H
+#define QC_TREND_STORE_H
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <TSystem.h>
+#include <TString.h>
+#include "../coin/FileStamp.h"
+
+//--------------------------------------------------
+// QCRunMetrics: what one run contributes to the trends
+//   Beta* : hms/shms, Gaussian peak of beta (GaussianPeak.h)
+//   Ct*   : coin, Gaussian peak of the ROC2 CT
+//   *Ok   : the peak estimate succeeded (only then the run is on the trend plot)
+//   *Err  : uncertainties of mean and sigma
+//--------------------------------------------------
+struct QCRunMetrics {
+  int      Run = 0;
+  Long_t   Mtime = 0;
+  Long64_t Size = 0;
+  UInt_t   CutHash = 0;
+  bool     BetaOk = false;
+  double   BetaMean = std::nan(""), BetaSigma = std::nan(""), BetaEntries = std::nan("");
+  double   BetaMeanErr = std::nan(""), BetaSigmaErr = std::nan("");
+  bool     CtOk = false;
+  double   CtMean = std::nan(""), CtSigma = std::nan(""), CtEntries = std::nan("");
+  double   CtMeanErr = std::nan(""), CtSigmaErr = std::nan("");
+};
+
+class QCTrendStore {
+public:
+  explicit QCTrendStore(const std::string &Dir = "./QC_TRENDS")
+    : fDir(Dir), fPath(Dir + "/qc_trends.csv") { Load(); }
+
+  // Stored metrics of a run; false if missing or stale (file stamp or cuts changed)
+  bool Lookup(const TString &Spec, int Run, const std::string &RootPath, UInt_t CutHash, QCRunMetrics &M) const {
+    Long_t Mtime = 0; Long64_t Size = 0;
+    if (!GetFileStamp(RootPath, Mtime, Size)) return false;
+    auto it = fRows.find(Key(Spec.Data(), Run));
+    if (it == fRows.end()) return false;
+    const QCRunMetrics &R = it->second;
+    if (R.Mtime != Mtime || R.Size != Size || R.CutHash != CutHash) return false;
+    M = R;
+    return true;
+  }
+
+  void Store(const TString &Spec, const QCRunMetrics &M) { fRows[Key(Spec.Data(), M.Run)] = M; }
+
+  // Rewrite the CSV file (temporary file + rename) with this store's rows merged into the ones on
+  // disk: all specs share the file, and overlapping invocations (batch and follow, hms and coin)
+  // must not drop each other's rows
+  void Save() {
+    Read(fRows);
+    gSystem->mkdir(fDir.c_str(), true);
+    std::string Tmp = fPath + CacheTmpSuffix();
+    std::ofstream Out(Tmp);
+    Out << "spec,run,cut_hash,mtime,size,beta_ok,beta_mean,beta_sigma,beta_entries,ct_ok,ct_mean,ct_sigma,ct_entries,"
+           "beta_mean_err,beta_sigma_err,ct_mean_err,ct_sigma_err\n";
+    for (const auto &kv : fRows) {
+      const QCRunMetrics &M = kv.second;
+      Out << kv.first.first << ',' << M.Run << ',' << M.CutHash << ',' << M.Mtime << ',' << M.Size << ','
+          << Form("%d,%.17g,%.17g,%.17g,%d,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g",
+                  int(M.BetaOk), M.BetaMean, M.BetaSigma, M.BetaEntries,
+                  int(M.CtOk), M.CtMean, M.CtSigma, M.CtEntries,
+                  M.BetaMeanErr, M.BetaSigmaErr, M.CtMeanErr, M.CtSigmaErr) << '\n';
+    }
+    Out.close();
+    gSystem->Rename(Tmp.c_str(), fPath.c_str());
+  }
+
+private:
+  typedef std::pair<std::string, int> Key;
+
+  void Load() { Read(fRows); }
+
+  // Add the rows of the CSV file that are not in Rows (those in Rows are kept)
+  void Read(std::map<Key, QCRunMetrics> &Rows) const {
+    std::ifstream In(fPath);
+    std::string Line;
+    while (std::getline(In, Line)) {
+      if (Line.empty() || Line.compare(0, 5, "spec,") == 0) continue;
+      std::vector<std::string> F;
+      std::istringstream Iss(Line);
+      for (std::string S; std::getline(Iss, S, ',');) F.push_back(S);
+      if (F.size() != 13 && F.size() != 17) continue; // 13: files written before the *_err columns
+      QCRunMetrics M;
+      M.Run         = std::atoi(F[1].c_str());
+      M.CutHash     = (UInt_t)std::strtoul(F[2].c_str(), nullptr, 10);
+      M.Mtime       = std::atol(F[3].c_str());
+      M.Size        = std::atoll(F[4].c_str());
+      M.BetaOk      = std::atoi(F[5].c_str()) != 0;
+      M.BetaMean    = std::strtod(F[6].c_str(), nullptr);
+      M.BetaSigma   = std::strtod(F[7].c_str(), nullptr);
+      M.BetaEntries = std::strtod(F[8].c_str(), nullptr);
+      M.CtOk        = std::atoi(F[9].c_str()) != 0;
+      M.CtMean      = std::strtod(F[10].c_str(), nullptr);
+      M.CtSigma     = std::strtod(F[11].c_str(), nullptr);
+      M.CtEntries   = std::strtod(F[12].c_str(), nullptr);
+      if (F.size() == 17) {
+        M.BetaMeanErr  = std::strtod(F[13].c_str(), nullptr);
+        M.BetaSigmaErr = std::strtod(F[14].c_str(), nullptr);
+        M.CtMeanErr    = std::strtod(F[15].c_str(), nullptr);
+        M.CtSigmaErr   = std::strtod(F[16].c_str(), nullptr);
+      }
+      Rows.emplace(Key(F[0], M.Run), M);
+    }
+  }
+
+  std::string fDir, fPath;
+  std::map<Key, QCRunMetrics> fRows;
+};
+
+#endif // QC_TREND_STORE_H
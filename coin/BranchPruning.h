@@ -0,0 +1,68 @@
+// BranchPruning.h
+// Work out which branches a job reads from its expressions (variables, cuts, CT branch),
+// disable every other branch and set up a TTreeCache sized for the ones left.
+#ifndef BRANCH_PRUNING_H
+#define BRANCH_PRUNING_H
+
+#include <set>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iostream>
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TTreeFormula.h"
+#include "TString.h"
+
+// Names of the branches read by the expressions; false if one of them does not compile
+inline bool BranchesForExpressions(TTree* T, const std::vector<TString>& Exprs, std::set<std::string>& Names) {
+  for (const auto& E : Exprs) {
+    if (E.Length() == 0) continue;
+    TTreeFormula F("fBranchPruning", E, T);
+    if (F.GetNdim() == 0) {
+      std::cerr << "[WARN] BranchPruning: cannot compile '" << E << "'; keeping all branches\n";
+      return false;
+    }
+    for (int i = 0; i < F.GetNcodes(); ++i) {
+      TLeaf* L = F.GetLeaf(i);
+      if (L && L->GetBranch()) Names.insert(L->GetBranch()->GetName());
+    }
+  }
+  return true;
+}
+
+// Enable only the branches the expressions need, then cache exactly those branches
+// (no learning phase). The cache holds about two clusters of them, within [1 MB, MaxCacheBytes].
+inline void PruneBranchesForExpressions(TTree* T, const std::vector<TString>& Exprs,
+                                        Long64_t MaxCacheBytes = 256LL*1024*1024) {
+  if (!T) return;
+  T->SetBranchStatus("*", 1); // formulas are compiled against the full branch list
+  std::set<std::string> Names;
+  if (!BranchesForExpressions(T, Exprs, Names) || Names.empty()) return;
+
+  T->SetBranchStatus("*", 0);
+  Long64_t ZipBytes = 0;
+  std::vector<std::string> Cached; // branches of T itself (friend trees are read from their own file)
+  for (const auto& N : Names) {
+    T->SetBranchStatus(N.c_str(), 1);
+    TBranch* B = T->GetBranch(N.c_str());
+    if (!B || B->GetTree() != T) continue;
+    ZipBytes += B->GetZipBytes();
+    Cached.push_back(N);
+  }
+
+  // Compressed bytes per cluster of the enabled branches (AutoFlush > 0 is entries per cluster)
+  const Long64_t Entries = std::max<Long64_t>(1, T->GetEntries());
+  const Long64_t AutoFlush = T->GetAutoFlush();
+  Long64_t PerCluster = (AutoFlush > 0) ? ZipBytes / std::max<Long64_t>(1, Entries / AutoFlush)
+                                        : ZipBytes / 10;
+  Long64_t CacheBytes = std::min(MaxCacheBytes, std::max<Long64_t>(1024*1024, 2 * PerCluster));
+
+  T->SetCacheSize(CacheBytes);
+  for (const auto& N : Cached) T->AddBranchToCache(N.c_str(), true);
+  T->StopCacheLearningPhase();
+}
+
+#endif // BRANCH_PRUNING_H
@@ -0,0 +1,201 @@
+// CoincidencePeakCache.h
+// On-disk cache of CoincidenceResult per run, so the CT peak is only searched once.
+//
+// Key   : run number, hash of the cuts, hash of every CoincidenceConfig field.
+// Valid : only while the input ROOT file keeps the mtime (and size) it had when stored.
+// File  : one text line per entry in ./CT_PEAK_CACHE/ct_peak_cache.txt (numbers with %.17g,
+//         so cached yields are bit-identical to freshly computed ones).
+#ifndef COINCIDENCE_PEAK_CACHE_H
+#define COINCIDENCE_PEAK_CACHE_H
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <tuple>
+#include <mutex>
+#include "TSystem.h"
+#include "TString.h"
+#include "FileStamp.h"
+#include "CoincidenceRandomSubtraction.h"
+
+// Helper: hash of all config fields that change the peak, windows or yields
+inline UInt_t CoincidenceConfigHash(const CoincidenceConfig& Config) {
+  TString Key = TString::Format("%s|%.17g|%.17g|%d|%.17g|%.17g|%d|%d",
+                                Config.CtBranchName.Data(),
+                                Config.WideWindowMinNs, Config.WideWindowMaxNs,
+                                Config.CtHistogramNBins, Config.RfPeriodNs,
+                                Config.PeakHalfWidthNs, Config.MinSidePeak, Config.MaxSidePeaks);
+  return Key.Hash();
+}
+
+class CoincidencePeakCache {
+public:
+  explicit CoincidencePeakCache(const std::string& Dir = "./CT_PEAK_CACHE")
+    : fDir(Dir), fPath(Dir + "/ct_peak_cache.txt") { Load(); }
+
+  // Look up a result; false on a miss or if the input file changed since it was stored
+  bool Lookup(int Run, const std::string& RootPath, const TString& Cuts,
+              const CoincidenceConfig& Config, CoincidenceResult& R) const {
+    Long_t Mtime = 0; Long64_t Size = 0;
+    if (!GetFileStamp(RootPath, Mtime, Size)) return false;
+    std::lock_guard<std::mutex> Lock(fMutex);
+    auto it = fEntries.find(MakeKey(Run, Cuts, Config));
+    if (it == fEntries.end() || it->second.Mtime != Mtime || it->second.Size != Size) return false;
+    R = it->second.Result;
+    return true;
+  }
+
+  // Store (or replace) a result in memory; written to the cache file by the next Save
+  void Store(int Run, const std::string& RootPath, const TString& Cuts,
+             const CoincidenceConfig& Config, const CoincidenceResult& R) {
+    Entry E;
+    if (!GetFileStamp(RootPath, E.Mtime, E.Size)) return;
+    E.Result = R;
+    std::lock_guard<std::mutex> Lock(fMutex);
+    fEntries[MakeKey(Run, Cuts, Config)] = E;
+    fUnsaved = true;
+  }
+
+  // Rewrite the cache file with this process's entries merged into the ones on disk (if any
+  // entry was stored since the last Save): shard workers share the cache, and none may drop
+  // the peaks another one stored since it loaded
+  void Save() {
+    std::lock_guard<std::mutex> Lock(fMutex);
+    if (!fUnsaved) return;
+    Write();
+    fUnsaved = false;
+  }
+
+private:
+  typedef std::tuple<int, UInt_t, UInt_t> Key; // run, cut hash, config hash
+  struct Entry { Long_t Mtime = 0; Long64_t Size = 0; CoincidenceResult Result; };
+
+  static Key MakeKey(int Run, const TString& Cuts, const CoincidenceConfig& Config) {
+    return Key(Run, Cuts.Hash(), CoincidenceConfigHash(Config));
+  }
+
+  void Load() { Read(fEntries); }
+
+  // Add the entries of the cache file that are not in Entries (those in Entries are kept)
+  void Read(std::map<Key, Entry>& Entries) const {
+    std::ifstream In(fPath);
+    std::string Line;
+    while (std::getline(In, Line)) {
+      if (Line.empty() || Line[0] == '#') continue;
+      std::istringstream Iss(Line);
+      int Run; UInt_t CutHash, CfgHash; Entry E; size_t NWin = 0;
+      CoincidenceResult& R = E.Result;
+      if (!(Iss >> Run >> CutHash >> CfgHash >> E.Mtime >> E.Size
+                >> R.PeakCenterNs >> R.CoinWindowNs.first >> R.CoinWindowNs.second
+                >> R.CoinYield >> R.CoinYieldErr >> R.RandomMeanYield >> R.RandomMeanYieldErr
+                >> R.RandomSubtractedYield >> R.RandomSubtractedYieldErr >> NWin)) continue;
+      bool Ok = true;
+      for (size_t k=0; k<NWin && Ok; ++k) {
+        double Lo, Hi;
+        Ok = bool(Iss >> Lo >> Hi);
+        if (Ok) R.RandomWindowListNs.emplace_back(Lo, Hi);
+      }
+      if (Ok) Entries.emplace(Key(Run, CutHash, CfgHash), E);
+    }
+  }
+
+  // Merge and rewrite (fMutex held)
+  void Write() {
+    Read(fEntries);
+    gSystem->mkdir(fDir.c_str(), true);
+    std::string Tmp = fPath + CacheTmpSuffix();
+    std::ofstream Out(Tmp);
+    Out << "# run cutHash configHash mtime size peak coinLo coinHi coin coinErr randMean randMeanErr sub subErr nWindows [lo hi]...\n";
+    for (const auto& kv : fEntries) {
+      const CoincidenceResult& R = kv.second.Result;
+      Out << std::get<0>(kv.first) << ' ' << std::get<1>(kv.first) << ' ' << std::get<2>(kv.first) << ' '
+          << kv.second.Mtime << ' ' << kv.second.Size
+          << Form(" %.17g %.17g %.17g %.17g %.17g %.17g %.17g %.17g %.17g",
+                  R.PeakCenterNs, R.CoinWindowNs.first, R.CoinWindowNs.second,
+                  R.CoinYield, R.CoinYieldErr, R.RandomMeanYield, R.RandomMeanYieldErr,
+                  R.RandomSubtractedYield, R.RandomSubtractedYieldErr)
+          << ' ' << R.RandomWindowListNs.size();
+      for (const auto& w : R.RandomWindowListNs) Out << Form(" %.17g %.17g", w.first, w.second);
+      Out << '\n';
+    }
+    Out.close();
+    gSystem->Rename(Tmp.c_str(), fPath.c_str());
+  }
+
+  std::string fDir, fPath;
+  std::map<Key, Entry> fEntries;
+  bool                 fUnsaved = false; // entries stored since the last Save
+  mutable std::mutex   fMutex; // runs may be processed in parallel (ParallelRuns.h)
+};
+
+// Shared cache instance for the macros
+inline CoincidencePeakCache& GetCoincidencePeakCache() {
+  static CoincidencePeakCache Cache;
+  return Cache;
+}
+
+// ComputeCoincidenceRandomSubtraction, but only when the cache has no valid entry for this run
+inline CoincidenceResult ComputeCoincidenceRandomSubtractionCached(
+    int Run, const std::string& RootPath, TTree* Tree,
+    const TString& BaseCuts, const CoincidenceConfig& Config)
+{
+  CoincidenceResult R;
+  if (GetCoincidencePeakCache().Lookup(Run, RootPath, BaseCuts, Config, R)) return R;
+  R = ComputeCoincidenceRandomSubtraction(Tree, BaseCuts, Config);
+  GetCoincidencePeakCache().Store(Run, RootPath, BaseCuts, Config, R);
+  GetCoincidencePeakCache().Save();
+  return R;
+}
+
+// FillRandomSubtractedOutputs with per-run cached peaks: if every cut group of the requests
+// has a valid cache entry the CT scan is skipped, otherwise the results are stored afterwards.
+inline std::vector<CoincidenceResult> FillRandomSubtractedOutputsCached(
+    int Run, const std::string& RootPath, TTree* Tree,
+    const TypedCut& BaseCuts,
+    const std::vector<RandomSubtractionRequest>& Requests,
+    const std::vector<RandomSubtractionSparseRequest>& SparseRequests,
+    const CoincidenceConfig& Config)
+{
+  CoincidencePeakCache& Cache = GetCoincidencePeakCache();
+  // Cut string of each request, in the order of the returned results
+  std::vector<TString> RequestCuts;
+  for (const auto& Q : Requests)       RequestCuts.push_back(CombineCutsAND(BaseCuts.Title(), Q.ExtraCuts.Title()));
+  for (const auto& Q : SparseRequests) RequestCuts.push_back(CombineCutsAND(BaseCuts.Title(), Q.ExtraCuts.Title()));
+
+  std::vector<CoincidenceResult> Known(RequestCuts.size());
+  bool AllKnown = true;
+  for (size_t r=0; r<RequestCuts.size() && AllKnown; ++r)
+    AllKnown = Cache.Lookup(Run, RootPath, RequestCuts[r], Config, Known[r]);
+  if (AllKnown) return FillRandomSubtractedOutputs(Tree, BaseCuts, Requests, SparseRequests, Config, &Known);
+
+  // Requests with the same cuts share one result: each cut group is stored once, then the file
+  // is rewritten once for the run
+  std::vector<CoincidenceResult> Results = FillRandomSubtractedOutputs(Tree, BaseCuts, Requests, SparseRequests, Config);
+  for (size_t r=0; r<RequestCuts.size(); ++r)
+    if (std::find(RequestCuts.begin(), RequestCuts.begin() + r, RequestCuts[r]) == RequestCuts.begin() + r)
+      Cache.Store(Run, RootPath, RequestCuts[r], Config, Results[r]);
+  Cache.Save();
+  return Results;
+}
+
+inline std::vector<CoincidenceResult> FillRandomSubtractedHistogramsCached(
+    int Run, const std::string& RootPath, TTree* Tree,
+    const TypedCut& BaseCuts,
+    const std::vector<RandomSubtractionRequest>& Requests,
+    const CoincidenceConfig& Config)
+{
+  return FillRandomSubtractedOutputsCached(Run, RootPath, Tree, BaseCuts, Requests, {}, Config);
+}
+
+inline std::vector<CoincidenceResult> FillRandomSubtractedSparseCached(
+    int Run, const std::string& RootPath, TTree* Tree,
+    const TypedCut& BaseCuts,
+    const std::vector<RandomSubtractionSparseRequest>& Requests,
+    const CoincidenceConfig& Config)
+{
+  return FillRandomSubtractedOutputsCached(Run, RootPath, Tree, BaseCuts, {}, Requests, Config);
+}
+
+#endif // COINCIDENCE_PEAK_CACHE_H
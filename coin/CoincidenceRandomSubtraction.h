@@ -4,11 +4,18 @@
 #include <utility>
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <iostream>
 #include "TTree.h"
+#include "TTreeFormula.h"
+#include "TEntryList.h"
 #include "TH1.h"
 #include "TH1D.h"
+#include "TH2D.h"
+#include "THnSparse.h"
 #include "TString.h"
 #include "TAxis.h"
+#include "CompiledCuts.h"
 
 struct CoincidenceConfig {
   // Branch name for coincidence-time
@@ -27,7 +34,9 @@ struct CoincidenceConfig {
   // Half-width of the coin window around the peak center (ns). (lo,hi)=(t0±PeakHalfWidthNs)
   double PeakHalfWidthNs = 1.0;
 
-  // Try up to this many peaks on each side for random windows (only those inside wide window are used).
+  // Random windows at k = MinSidePeak..MaxSidePeaks RF periods on each side (only those inside
+  // the wide window are used). MinSidePeak = 2 skips the first sideband (k = 1) next to the peak.
+  int    MinSidePeak = 2;
   int    MaxSidePeaks = 6;
 };
 
@@ -67,26 +76,10 @@ inline void EnsureSumw2(TH1* h) {
   if (h && h->GetSumw2N() == 0) h->Sumw2();
 }
 
-// Compute CT peak, coin window, random windows and all three yields.
-inline CoincidenceResult ComputeCoincidenceRandomSubtraction(
-    TTree* Tree,
-    const TString& BaseCuts,          // your existing d&d cuts (unchanged)
-    const CoincidenceConfig& Config)
-{
+// Find the peak, coin window, random windows and all three yields from a filled CT histogram.
+inline CoincidenceResult FindCoincidenceWindows(TH1D* Hct, const CoincidenceConfig& Config) {
   CoincidenceResult R;
-
-  // 1) Wide gate + base cuts
-  TString WideGate = BuildRangeCut(Config.CtBranchName, Config.WideWindowMinNs, Config.WideWindowMaxNs);
-  TString CutsWide = CombineCutsAND(BaseCuts, WideGate);
-
-  // 2) Fill CT hist to find peak
-  std::unique_ptr<TH1D> Hct(new TH1D("Hct",";Coincidence time (ns);Counts",
-                                     Config.CtHistogramNBins,
-                                     Config.WideWindowMinNs, Config.WideWindowMaxNs));
-  //Hct->Sumw2();
-  EnsureSumw2(Hct.get());
-  Tree->Project("Hct", Config.CtBranchName, CutsWide);
-  if (Hct->GetEntries()==0) return R;
+  if (!Hct || Hct->GetEntries()==0) return R;
 
   int    MaxBin     = Hct->GetMaximumBin();
   double PeakCenter = Hct->GetBinCenter(MaxBin);
@@ -107,8 +100,7 @@ inline CoincidenceResult ComputeCoincidenceRandomSubtraction(
   // 4) Random windows at ±k*RF with same width; keep only those inside the wide gate
   double SumRand = 0.0, SumRandVar = 0.0;
   int    Nused   = 0;
-  for (int k=1; k<=Config.MaxSidePeaks; ++k) {
-    if (k == 1) continue;  // skip the first sideband (±1) from both side
+  for (int k=std::max(1, Config.MinSidePeak); k<=Config.MaxSidePeaks; ++k) {
     for (int sgn : {-1, +1}) {
       double Center = PeakCenter + sgn * k * Config.RfPeriodNs;
       double Lo = Center - Config.PeakHalfWidthNs;
@@ -137,9 +129,31 @@ inline CoincidenceResult ComputeCoincidenceRandomSubtraction(
   return R;
 }
 
-// Make a random-subtracted histogram of some variable (e.g., "H.gtr.dp").
-// The output histogram must exist with desired binning; it will be reset and filled.
-inline CoincidenceResult FillRandomSubtractedHistogram(
+// Compute CT peak, coin window, random windows and all three yields.
+inline CoincidenceResult ComputeCoincidenceRandomSubtraction(
+    TTree* Tree,
+    const TString& BaseCuts,          // your existing d&d cuts (unchanged)
+    const CoincidenceConfig& Config)
+{
+  // 1) Wide gate + base cuts
+  TString WideGate = BuildRangeCut(Config.CtBranchName, Config.WideWindowMinNs, Config.WideWindowMaxNs);
+  TString CutsWide = CombineCutsAND(BaseCuts, WideGate);
+
+  // 2) Fill CT hist to find peak
+  std::unique_ptr<TH1D> Hct(new TH1D("Hct",";Coincidence time (ns);Counts",
+                                     Config.CtHistogramNBins,
+                                     Config.WideWindowMinNs, Config.WideWindowMaxNs));
+  //Hct->Sumw2();
+  EnsureSumw2(Hct.get());
+  Tree->Project("Hct", Config.CtBranchName, CutsWide);
+
+  // 3) and 4) windows and yields
+  return FindCoincidenceWindows(Hct.get(), Config);
+}
+
+// Reference path: one TTree::Project per window (CT peak, coin window, each random window).
+// Kept for cross-checks of the single-pass engine below; same arguments as FillRandomSubtractedHistogram.
+inline CoincidenceResult FillRandomSubtractedHistogramPerWindow(
     TTree* Tree,
     const TString& BaseCuts,              // your existing d&d cuts
     const char* VarExpression,            // e.g. "H.gtr.dp"
@@ -189,3 +203,508 @@ inline CoincidenceResult FillRandomSubtractedHistogram(
 
   return R;
 }
+
+//============SINGLE-PASS ENGINE============
+
+// Helper: the edge value a BuildRangeCut string really compares against (it prints with %.2f)
+inline double RangeCutEdge(double X) {
+  return TString::Format("%.2f", X).Atof();
+}
+
+// Helper: first instance of a formula for the currently loaded entry (false if it has no data)
+inline bool EvalFirstInstance(TTreeFormula* F, double& Value) {
+  if (F->GetNdata() <= 0) return false;
+  Value = F->EvalInstance(0);
+  return true;
+}
+
+// One output of FillRandomSubtractedHistograms: a variable, an optional extra cut that is
+// ANDed with the base cuts for this output only (e.g. "(H.kin.primary.nu>0)" for z), and
+// the pre-booked histogram that receives the random-subtracted result.
+// ExtraCuts may be a string or a compiled TypedCut.
+struct RandomSubtractionRequest {
+  TString  VarExpression;
+  TypedCut ExtraCuts;
+  TH1*     OutputHist = nullptr;
+};
+
+// N-dimensional output: one variable per axis of a pre-booked THnSparse (e.g. z, Q2, x_bj, phipq;
+// see BookSparseHistogram). An event is filled only if every variable has a value.
+struct RandomSubtractionSparseRequest {
+  std::vector<TString> VarExpressions;
+  TypedCut             ExtraCuts;
+  THnBase*             OutputHist = nullptr;
+};
+
+// Helper: book a THnSparseD with one axis per variable (axis titles = the variables)
+inline THnSparseD* BookSparseHistogram(const char* Name, const std::vector<TString>& Vars,
+                                       const std::vector<int>& NBins,
+                                       const std::vector<double>& XMin, const std::vector<double>& XMax) {
+  THnSparseD* H = new THnSparseD(Name, Name, int(Vars.size()), NBins.data(), XMin.data(), XMax.data());
+  for (size_t d=0; d<Vars.size(); ++d) H->GetAxis(int(d))->SetTitle(Vars[d]);
+  H->Sumw2();
+  return H;
+}
+
+// Helper: random-subtracted projection of a sparse output onto one axis (or two: Y vs X), with
+// errors from its Sumw2. Ranges set on the other axes (GetAxis(d)->SetRange) select a slice.
+// The caller owns the returned histogram.
+inline TH1D* ProjectSparse(const THnBase* H, int Axis, const char* Name) {
+  TH1D* P = H->Projection(Axis, "E");
+  P->SetName(Name);
+  P->SetDirectory(nullptr);
+  return P;
+}
+inline TH2D* ProjectSparse(const THnBase* H, int AxisY, int AxisX, const char* Name) {
+  TH2D* P = H->Projection(AxisY, AxisX, "E");
+  P->SetName(Name);
+  P->SetDirectory(nullptr);
+  return P;
+}
+
+// What the engine fills: the outputs of all 1D and N-dimensional requests, each with its cut
+// group and its value columns [Col, Col + NDim) of the per-event value array.
+struct RandomSubtractionOutput {
+  int      Group = 0;
+  size_t   Col = 0;
+  int      NDim = 1;
+  TH1*     Hist = nullptr;     // 1D request
+  THnBase* HistN = nullptr;    // N-dimensional request
+};
+
+// Sorts events into the coin window (weight +1) and the random windows (weight -1/M) of each
+// cut group and fills the outputs in that group. The coin and random parts are accumulated
+// separately and the -1/M is applied once in Finish(), which keeps the result bit-identical to
+// the per-window TTree::Project path (and gives Sumw2 = coin + random/M^2 for every bin).
+class RandomSubtractionAccumulator {
+public:
+  RandomSubtractionAccumulator(const std::vector<RandomSubtractionOutput>& Outputs,
+                               const std::vector<CoincidenceResult>& GroupResults)
+    : fOutputs(Outputs), fGroupResults(GroupResults) {
+    const size_t NGroups = GroupResults.size();
+    fValid.resize(NGroups); fCoinEdge.resize(NGroups); fRandEdge.resize(NGroups);
+    for (size_t g=0; g<NGroups; ++g) {
+      const auto& W = GroupResults[g].CoinWindowNs;
+      fValid[g]    = (W.first < W.second);
+      fCoinEdge[g] = {RangeCutEdge(W.first), RangeCutEdge(W.second)};
+      for (const auto& win : GroupResults[g].RandomWindowListNs)
+        fRandEdge[g].emplace_back(RangeCutEdge(win.first), RangeCutEdge(win.second));
+    }
+    fHcoin.resize(Outputs.size()); fHrandSum.resize(Outputs.size());
+    fHcoinN.resize(Outputs.size()); fHrandSumN.resize(Outputs.size());
+    for (size_t o=0; o<Outputs.size(); ++o) {
+      if (Outputs[o].Hist) {
+        fHcoin[o].reset(static_cast<TH1*>(Outputs[o].Hist->Clone(Form("Hcoin_%zu", o))));
+        fHrandSum[o].reset(static_cast<TH1*>(Outputs[o].Hist->Clone(Form("HrandSum_%zu", o))));
+        for (TH1* h : {fHcoin[o].get(), fHrandSum[o].get()}) { h->SetDirectory(nullptr); h->Reset(); EnsureSumw2(h); }
+      } else {
+        fHcoinN[o].reset(static_cast<THnBase*>(Outputs[o].HistN->Clone(Form("HcoinN_%zu", o))));
+        fHrandSumN[o].reset(static_cast<THnBase*>(Outputs[o].HistN->Clone(Form("HrandSumN_%zu", o))));
+        for (THnBase* h : {fHcoinN[o].get(), fHrandSumN[o].get()}) { h->Reset(); h->Sumw2(); }
+      }
+    }
+  }
+
+  // Mask: bit g set if the event passes the cuts of group g. HasVal: one entry per output;
+  // Val: the value columns of all outputs.
+  void Add(double Ct, unsigned Mask, const char* HasVal, const double* Val) {
+    for (size_t g=0; g<fValid.size(); ++g) {
+      if (!(Mask & (1u << g)) || !fValid[g]) continue;
+      bool InCoin = (Ct > fCoinEdge[g].first && Ct < fCoinEdge[g].second);
+      int  NRand  = 0; // windows can overlap for wide PeakHalfWidthNs; count each like the per-window cuts did
+      for (const auto& w : fRandEdge[g]) if (Ct > w.first && Ct < w.second) ++NRand;
+      if (!InCoin && NRand == 0) continue;
+
+      for (size_t o=0; o<fOutputs.size(); ++o) {
+        if (fOutputs[o].Group != int(g) || !HasVal[o]) continue;
+        const double* X = Val + fOutputs[o].Col;
+        if (fOutputs[o].Hist) {
+          if (InCoin) fHcoin[o]->Fill(*X);
+          for (int k=0; k<NRand; ++k) fHrandSum[o]->Fill(*X);
+        } else {
+          if (InCoin) fHcoinN[o]->Fill(X);
+          for (int k=0; k<NRand; ++k) fHrandSumN[o]->Fill(X);
+        }
+      }
+    }
+  }
+
+  // Random-subtracted = coin - <random>, same arithmetic as the per-window path
+  void Finish() {
+    for (size_t o=0; o<fOutputs.size(); ++o) {
+      const int g = fOutputs[o].Group;
+      if (!fValid[g]) continue;
+      const int M = int(fGroupResults[g].RandomWindowListNs.size());
+      if (fOutputs[o].Hist) {
+        if (M > 0) fHrandSum[o]->Scale(1.0 / M);
+        fOutputs[o].Hist->Add(fHcoin[o].get());
+        fOutputs[o].Hist->Add(fHrandSum[o].get(), -1.0);
+      } else {
+        if (M > 0) fHrandSumN[o]->Scale(1.0 / M);
+        fOutputs[o].HistN->Add(fHcoinN[o].get());
+        fOutputs[o].HistN->Add(fHrandSumN[o].get(), -1.0);
+      }
+    }
+  }
+
+private:
+  const std::vector<RandomSubtractionOutput>&         fOutputs;
+  const std::vector<CoincidenceResult>&               fGroupResults;
+  std::vector<bool>                                   fValid;
+  std::vector<std::pair<double,double>>               fCoinEdge;
+  std::vector<std::vector<std::pair<double,double>>>  fRandEdge;
+  std::vector<std::unique_ptr<TH1>>                   fHcoin, fHrandSum;
+  std::vector<std::unique_ptr<THnBase>>               fHcoinN, fHrandSumN;
+};
+
+// Random-subtracted histograms of many variables (1D requests) and of N-dimensional variable
+// tuples (sparse requests) from ONE read of the tree.
+// Without KnownResults every entry passing the base cuts and the wide gate is buffered once
+// (CT + variable values); the CT histogram of each cut group gives the peak, then the buffer is
+// split into the coin and random windows. With KnownResults (one per request, e.g. from a cheap
+// prior CT pass or a cache) events are split while reading and nothing is buffered.
+// Each 1D output equals what the per-window path gives for the same variable and cuts; the
+// returned results are in request order (1D requests first, then the sparse ones). BaseCuts may be a cut string (TTreeFormula fallback)
+// or a compiled TypedCut; plain-branch variables and the CT branch are always read natively.
+inline std::vector<CoincidenceResult> FillRandomSubtractedOutputs(
+    TTree* Tree,
+    const TypedCut& BaseCuts,
+    const std::vector<RandomSubtractionRequest>& Requests,
+    const std::vector<RandomSubtractionSparseRequest>& SparseRequests,
+    const CoincidenceConfig& Config,
+    const std::vector<CoincidenceResult>* KnownResults = nullptr)
+{
+  const size_t NReq = Requests.size() + SparseRequests.size();
+  std::vector<CoincidenceResult> Results(NReq);
+  for (const auto& Q : Requests) { Q.OutputHist->Reset(); EnsureSumw2(Q.OutputHist); }
+  for (const auto& Q : SparseRequests) { Q.OutputHist->Reset(); Q.OutputHist->Sumw2(); }
+  if (!Tree || NReq == 0) return Results;
+
+  // Outputs and their variables (value columns): 1D requests, then sparse requests
+  std::vector<RandomSubtractionOutput> Outputs(NReq);
+  std::vector<TString>  VarOfCol;
+  std::vector<TypedCut> ExtraOf(NReq);
+  for (size_t r=0; r<NReq; ++r) {
+    RandomSubtractionOutput& O = Outputs[r];
+    O.Col = VarOfCol.size();
+    if (r < Requests.size()) {
+      O.Hist = Requests[r].OutputHist;
+      VarOfCol.push_back(Requests[r].VarExpression);
+      ExtraOf[r] = Requests[r].ExtraCuts;
+    } else {
+      const RandomSubtractionSparseRequest& Q = SparseRequests[r - Requests.size()];
+      if (int(Q.VarExpressions.size()) != Q.OutputHist->GetNdimensions()) {
+        std::cerr << "[ERROR] Sparse output " << Q.OutputHist->GetName() << " has " << Q.OutputHist->GetNdimensions()
+                  << " axes but " << Q.VarExpressions.size() << " variables\n";
+        return Results;
+      }
+      O.HistN = Q.OutputHist;
+      O.NDim  = int(Q.VarExpressions.size());
+      VarOfCol.insert(VarOfCol.end(), Q.VarExpressions.begin(), Q.VarExpressions.end());
+      ExtraOf[r] = Q.ExtraCuts;
+    }
+  }
+  const size_t NCol = VarOfCol.size();
+
+  // Requests with the same extra cut share one CT histogram (and so one peak)
+  std::vector<TypedCut> GroupCuts;
+  for (size_t r=0; r<NReq; ++r) {
+    auto it = std::find_if(GroupCuts.begin(), GroupCuts.end(),
+                           [&](const TypedCut& C) { return C.Title() == ExtraOf[r].Title(); });
+    Outputs[r].Group = int(it - GroupCuts.begin());
+    if (it == GroupCuts.end()) GroupCuts.push_back(ExtraOf[r]);
+  }
+  const int NGroups = int(GroupCuts.size());
+  if (NGroups > 32) { std::cerr << "[ERROR] Too many distinct extra cuts (" << NGroups << ", max 32)\n"; return Results; }
+
+  std::vector<CoincidenceResult> GroupResults(NGroups);
+  const bool Known = (KnownResults && KnownResults->size() == NReq);
+  if (Known) for (size_t r=0; r<NReq; ++r) GroupResults[Outputs[r].Group] = (*KnownResults)[r];
+
+  // Bound predicates and values: base cuts, CT, one per extra cut and one per value column
+  BoundBranches Branches(Tree);
+  TypedCut::Predicate PassBase = BaseCuts.Bind(Branches);
+  ValueReader ReadCt = BindValue(Branches, Config.CtBranchName);
+  std::vector<TypedCut::Predicate> PassGroup(NGroups);
+  for (int g=0; g<NGroups; ++g) if (!GroupCuts[g].IsEmpty()) PassGroup[g] = GroupCuts[g].Bind(Branches);
+  std::vector<ValueReader> ReadVar(NCol);
+  for (size_t c=0; c<NCol; ++c) ReadVar[c] = BindValue(Branches, VarOfCol[c]);
+
+  bool Bad = !ReadCt;
+  for (auto& F : ReadVar) Bad = Bad || !F;
+  if (Bad) { std::cerr << "[ERROR] Could not compile cut/variable formulas on tree " << Tree->GetName() << "\n"; return Results; }
+
+  // CT histogram per group (only needed when the peak is not known yet)
+  std::vector<std::unique_ptr<TH1D>> Hct(NGroups);
+  if (!Known) {
+    for (int g=0; g<NGroups; ++g) {
+      Hct[g].reset(new TH1D(Form("Hct_group%d", g), ";Coincidence time (ns);Counts",
+                            Config.CtHistogramNBins, Config.WideWindowMinNs, Config.WideWindowMaxNs));
+      Hct[g]->SetDirectory(nullptr);
+      EnsureSumw2(Hct[g].get());
+    }
+  }
+  std::unique_ptr<RandomSubtractionAccumulator> Acc;
+  if (Known) Acc.reset(new RandomSubtractionAccumulator(Outputs, GroupResults));
+
+  const double WideLo = RangeCutEdge(Config.WideWindowMinNs);
+  const double WideHi = RangeCutEdge(Config.WideWindowMaxNs);
+
+  std::vector<double>   BufCt;
+  std::vector<unsigned> BufMask;
+  std::vector<double>   BufVal;   // NCol values per buffered entry
+  std::vector<char>     BufHasVal; // NReq flags per buffered entry
+  std::vector<double>   Val(NCol);
+  std::vector<char>     HasVal(NReq);
+
+  // The only pass over the tree
+  const Long64_t NToRead = Tree->GetEntryList() ? Tree->GetEntryList()->GetN() : Tree->GetEntries();
+  for (Long64_t i=0; i<NToRead; ++i) {
+    Long64_t Entry = Tree->GetEntryNumber(i);
+    if (Entry < 0 || !Branches.GetEntry(Entry)) break;
+
+    if (!PassBase()) continue;
+    double Ct = 0.0;
+    if (!ReadCt(Ct) || !(Ct > WideLo && Ct < WideHi)) continue;
+
+    unsigned Mask = 0;
+    for (int g=0; g<NGroups; ++g)
+      if (!PassGroup[g] || PassGroup[g]()) Mask |= (1u << g);
+    if (Mask == 0) continue;
+
+    for (size_t r=0; r<NReq; ++r) {
+      const RandomSubtractionOutput& O = Outputs[r];
+      HasVal[r] = (Mask & (1u << O.Group)) != 0;
+      for (int d=0; d<O.NDim; ++d) {
+        double& V = Val[O.Col + d];
+        if (HasVal[r] && !ReadVar[O.Col + d](V)) HasVal[r] = false;
+        if (!HasVal[r]) V = 0.0;
+      }
+    }
+
+    if (Known) { Acc->Add(Ct, Mask, HasVal.data(), Val.data()); continue; }
+
+    for (int g=0; g<NGroups; ++g) if (Mask & (1u << g)) Hct[g]->Fill(Ct);
+    BufCt.push_back(Ct);
+    BufMask.push_back(Mask);
+    BufVal.insert(BufVal.end(), Val.begin(), Val.end());
+    BufHasVal.insert(BufHasVal.end(), HasVal.begin(), HasVal.end());
+  }
+
+  // Peak and windows per group from the buffered pass, then split the buffer
+  if (!Known) {
+    for (int g=0; g<NGroups; ++g) GroupResults[g] = FindCoincidenceWindows(Hct[g].get(), Config);
+    Acc.reset(new RandomSubtractionAccumulator(Outputs, GroupResults));
+    for (size_t e=0; e<BufCt.size(); ++e)
+      Acc->Add(BufCt[e], BufMask[e], &BufHasVal[e*NReq], &BufVal[e*NCol]);
+  }
+  Acc->Finish();
+
+  for (size_t r=0; r<NReq; ++r) Results[r] = GroupResults[Outputs[r].Group];
+  return Results;
+}
+
+// 1D requests only
+inline std::vector<CoincidenceResult> FillRandomSubtractedHistograms(
+    TTree* Tree,
+    const TypedCut& BaseCuts,
+    const std::vector<RandomSubtractionRequest>& Requests,
+    const CoincidenceConfig& Config,
+    const std::vector<CoincidenceResult>* KnownResults = nullptr)
+{
+  return FillRandomSubtractedOutputs(Tree, BaseCuts, Requests, {}, Config, KnownResults);
+}
+
+// N-dimensional requests only: e.g. z x Q2 x x_bj x phipq yields in one pass, projected
+// afterwards with ProjectSparse (no second read of the data)
+inline std::vector<CoincidenceResult> FillRandomSubtractedSparse(
+    TTree* Tree,
+    const TypedCut& BaseCuts,
+    const std::vector<RandomSubtractionSparseRequest>& Requests,
+    const CoincidenceConfig& Config,
+    const std::vector<CoincidenceResult>* KnownResults = nullptr)
+{
+  return FillRandomSubtractedOutputs(Tree, BaseCuts, {}, Requests, Config, KnownResults);
+}
+
+// Make a random-subtracted histogram of some variable (e.g., "H.gtr.dp").
+// The output histogram must exist with desired binning; it will be reset and filled.
+// Uses the single-pass engine: one read of the tree instead of 2 + (number of random windows).
+// If KnownPeak is given (e.g. from ComputeCoincidenceRandomSubtraction or a cache) its windows
+// and yields are used as-is and the tree is only read to fill the histogram.
+inline CoincidenceResult FillRandomSubtractedHistogram(
+    TTree* Tree,
+    const TypedCut& BaseCuts,             // your existing d&d cuts (string or compiled)
+    const char* VarExpression,            // e.g. "H.gtr.dp"
+    TH1* OutputHist,                      // pre-booked with your binning
+    const CoincidenceConfig& Config,
+    const CoincidenceResult* KnownPeak = nullptr)
+{
+  std::vector<RandomSubtractionRequest> Requests = {{VarExpression, "", OutputHist}};
+  std::vector<CoincidenceResult> Known;
+  if (KnownPeak) Known.push_back(*KnownPeak);
+  return FillRandomSubtractedHistograms(Tree, BaseCuts, Requests, Config, KnownPeak ? &Known : nullptr).front();
+}
+
+//============INCREMENTAL ENGINE============
+
+// Random-subtracted histograms of a tree that grows while it is analysed (e.g. a replay file
+// still being written): each Add reads only the entries appended since the last one. The CT
+// histogram of each cut group, the selected events (CT + values, as the single-pass engine
+// buffers them) and the coin/random histograms of the current windows are kept between calls.
+// Update() finds the peaks on everything read so far; a group whose windows moved is refilled
+// from its buffered events. The outputs then equal FillRandomSubtractedHistograms over all
+// entries read so far, bit for bit. 1D requests only.
+class IncrementalRandomSubtraction {
+public:
+  IncrementalRandomSubtraction(const TypedCut& BaseCuts, const std::vector<RandomSubtractionRequest>& Requests,
+                               const CoincidenceConfig& Config, const ComputedColumns& Columns = ComputedColumns())
+    : fBaseCuts(BaseCuts), fRequests(Requests), fConfig(Config), fColumns(Columns), fGroupOf(Requests.size()) {
+    for (size_t r=0; r<Requests.size(); ++r) {
+      auto it = std::find_if(fGroupCuts.begin(), fGroupCuts.end(),
+                             [&](const TypedCut& C) { return C.Title() == Requests[r].ExtraCuts.Title(); });
+      fGroupOf[r] = int(it - fGroupCuts.begin());
+      if (it == fGroupCuts.end()) fGroupCuts.push_back(Requests[r].ExtraCuts);
+    }
+    const int NGroups = int(fGroupCuts.size());
+    if (NGroups > 32) { std::cerr << "[ERROR] Too many distinct extra cuts (" << NGroups << ", max 32)\n"; fGroupCuts.clear(); }
+    for (size_t g=0; g<fGroupCuts.size(); ++g) {
+      fHct.emplace_back(new TH1D(Form("Hct_incremental_group%zu", g), ";Coincidence time (ns);Counts",
+                                 Config.CtHistogramNBins, Config.WideWindowMinNs, Config.WideWindowMaxNs));
+      fHct.back()->SetDirectory(nullptr);
+      EnsureSumw2(fHct.back().get());
+    }
+    fApplied.resize(fGroupCuts.size());
+    fCoinEdge.resize(fGroupCuts.size());
+    fRandEdge.resize(fGroupCuts.size());
+    for (size_t r=0; r<Requests.size(); ++r) {
+      fHcoin.emplace_back(static_cast<TH1*>(Requests[r].OutputHist->Clone(Form("Hcoin_incremental_%zu", r))));
+      fHrandSum.emplace_back(static_cast<TH1*>(Requests[r].OutputHist->Clone(Form("HrandSum_incremental_%zu", r))));
+      for (TH1* h : {fHcoin[r].get(), fHrandSum[r].get()}) { h->SetDirectory(nullptr); h->Reset(); EnsureSumw2(h); }
+    }
+  }
+  IncrementalRandomSubtraction(const IncrementalRandomSubtraction&) = delete;
+  IncrementalRandomSubtraction& operator=(const IncrementalRandomSubtraction&) = delete;
+
+  // Entries read so far ([0, NRead()))
+  Long64_t NRead() const { return fNRead; }
+
+  // Read entries [NRead(), Last) of Tree (the same tree at every call); false if its cuts,
+  // CT or variables cannot be read
+  bool Add(TTree* Tree, Long64_t Last) {
+    if (!Tree || fGroupCuts.empty()) return false;
+    BoundBranches Branches(Tree);
+    std::function<void()> ComputeColumns = fColumns ? fColumns(Branches) : std::function<void()>();
+    TypedCut::Predicate PassBase = fBaseCuts.Bind(Branches);
+    ValueReader ReadCt = BindValue(Branches, fConfig.CtBranchName);
+    std::vector<TypedCut::Predicate> PassGroup(fGroupCuts.size());
+    for (size_t g=0; g<fGroupCuts.size(); ++g) if (!fGroupCuts[g].IsEmpty()) PassGroup[g] = fGroupCuts[g].Bind(Branches);
+    std::vector<ValueReader> ReadVar(fRequests.size());
+    bool Bad = !ReadCt;
+    for (size_t r=0; r<fRequests.size(); ++r) Bad = Bad || !(ReadVar[r] = BindValue(Branches, fRequests[r].VarExpression));
+    if (Bad) { std::cerr << "[ERROR] Could not compile cut/variable formulas on tree " << Tree->GetName() << "\n"; return false; }
+
+    const double WideLo = RangeCutEdge(fConfig.WideWindowMinNs);
+    const double WideHi = RangeCutEdge(fConfig.WideWindowMaxNs);
+    const size_t NReq = fRequests.size();
+    std::vector<double> Val(NReq);
+    std::vector<char>   HasVal(NReq);
+    for (; fNRead < Last; ++fNRead) {
+      if (!Branches.GetEntry(fNRead)) break;
+      if (ComputeColumns) ComputeColumns();
+      if (!PassBase()) continue;
+      double Ct = 0.0;
+      if (!ReadCt(Ct) || !(Ct > WideLo && Ct < WideHi)) continue;
+
+      unsigned Mask = 0;
+      for (size_t g=0; g<fGroupCuts.size(); ++g)
+        if (!PassGroup[g] || PassGroup[g]()) Mask |= (1u << g);
+      if (Mask == 0) continue;
+      for (size_t r=0; r<NReq; ++r) {
+        HasVal[r] = (Mask & (1u << fGroupOf[r])) != 0;
+        if (HasVal[r] && !ReadVar[r](Val[r])) HasVal[r] = false;
+        if (!HasVal[r]) Val[r] = 0.0;
+      }
+
+      for (size_t g=0; g<fGroupCuts.size(); ++g) if (Mask & (1u << g)) fHct[g]->Fill(Ct);
+      fBufCt.push_back(Ct);
+      fBufMask.push_back(Mask);
+      fBufVal.insert(fBufVal.end(), Val.begin(), Val.end());
+      fBufHasVal.insert(fBufHasVal.end(), HasVal.begin(), HasVal.end());
+      for (size_t g=0; g<fGroupCuts.size(); ++g) if (Mask & (1u << g)) Classify(g, fBufCt.size() - 1);
+    }
+    return true;
+  }
+
+  // Peaks, windows and yields from all entries read so far (one result per request, as
+  // FillRandomSubtractedHistograms returns them); each request's OutputHist is reset and set
+  // to its random-subtracted histogram
+  std::vector<CoincidenceResult> Update() {
+    for (size_t g=0; g<fGroupCuts.size(); ++g) {
+      CoincidenceResult R = FindCoincidenceWindows(fHct[g].get(), fConfig);
+      const bool Moved = (R.CoinWindowNs != fApplied[g].CoinWindowNs || R.RandomWindowListNs != fApplied[g].RandomWindowListNs);
+      fApplied[g] = R;
+      if (!Moved) continue;
+      // New windows: refill this group's coin/random histograms from the buffered events
+      fCoinEdge[g] = {RangeCutEdge(R.CoinWindowNs.first), RangeCutEdge(R.CoinWindowNs.second)};
+      fRandEdge[g].clear();
+      for (const auto& win : R.RandomWindowListNs) fRandEdge[g].emplace_back(RangeCutEdge(win.first), RangeCutEdge(win.second));
+      for (size_t r=0; r<fRequests.size(); ++r) if (fGroupOf[r] == int(g)) { fHcoin[r]->Reset(); fHrandSum[r]->Reset(); }
+      for (size_t e=0; e<fBufCt.size(); ++e) if (fBufMask[e] & (1u << g)) Classify(g, e);
+    }
+
+    std::vector<CoincidenceResult> Results(fRequests.size());
+    for (size_t r=0; r<fRequests.size(); ++r) {
+      TH1* Out = fRequests[r].OutputHist;
+      Out->Reset(); EnsureSumw2(Out);
+      if (fGroupCuts.empty()) continue;
+      const CoincidenceResult& R = fApplied[fGroupOf[r]];
+      Results[r] = R;
+      if (!(R.CoinWindowNs.first < R.CoinWindowNs.second)) continue;
+      // Same arithmetic as RandomSubtractionAccumulator::Finish, on a copy (more entries may follow)
+      std::unique_ptr<TH1> HrandMean(static_cast<TH1*>(fHrandSum[r]->Clone(Form("HrandMean_incremental_%zu", r))));
+      HrandMean->SetDirectory(nullptr);
+      const int M = int(R.RandomWindowListNs.size());
+      if (M > 0) HrandMean->Scale(1.0 / M);
+      Out->Add(fHcoin[r].get());
+      Out->Add(HrandMean.get(), -1.0);
+    }
+    return Results;
+  }
+
+private:
+  // Buffered event e into the coin/random histograms of group g's requests (current windows)
+  void Classify(size_t g, size_t e) {
+    const auto& W = fApplied[g].CoinWindowNs;
+    if (!(W.first < W.second)) return;
+    const double Ct = fBufCt[e];
+    const bool InCoin = (Ct > fCoinEdge[g].first && Ct < fCoinEdge[g].second);
+    int NRand = 0;
+    for (const auto& w : fRandEdge[g]) if (Ct > w.first && Ct < w.second) ++NRand;
+    if (!InCoin && NRand == 0) return;
+    const size_t NReq = fRequests.size();
+    for (size_t r=0; r<NReq; ++r) {
+      if (fGroupOf[r] != int(g) || !fBufHasVal[e*NReq + r]) continue;
+      const double X = fBufVal[e*NReq + r];
+      if (InCoin) fHcoin[r]->Fill(X);
+      for (int k=0; k<NRand; ++k) fHrandSum[r]->Fill(X);
+    }
+  }
+
+  TypedCut                                            fBaseCuts;
+  std::vector<RandomSubtractionRequest>               fRequests;
+  CoincidenceConfig                                   fConfig;
+  ComputedColumns                                     fColumns;
+  std::vector<int>                                    fGroupOf;
+  std::vector<TypedCut>                               fGroupCuts;
+  std::vector<std::unique_ptr<TH1D>>                  fHct;
+  std::vector<CoincidenceResult>                      fApplied;   // windows the coin/random histograms are filled with
+  std::vector<std::pair<double,double>>               fCoinEdge;
+  std::vector<std::vector<std::pair<double,double>>>  fRandEdge;
+  std::vector<std::unique_ptr<TH1>>                   fHcoin, fHrandSum;
+  std::vector<double>                                 fBufCt;
+  std::vector<unsigned>                               fBufMask;
+  std::vector<double>                                 fBufVal;    // one value per request and event
+  std::vector<char>                                   fBufHasVal;
+  Long64_t                                            fNRead = 0;
+};
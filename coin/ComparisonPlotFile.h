@@ -0,0 +1,154 @@
+// ComparisonPlotFile.h
+// Production / render split of the data vs simulation plots. Production writes the final
+// histograms of every variable into one ROOT file; the render stage draws the comparison and
+// ratio plots from that file in forked worker processes, so the data loop never waits on
+// graphics and plots can be re-styled without reading the trees again.
+//
+// File  : ./PLOT_OUTPUT/DataVsSim_coin.root (temporary file, unique per writer, + rename on Close)
+//   FormatVersion  TNamed, kComparisonPlotFormatVersion; the render stage refuses other versions
+//   Provenance     TNamed, free text from the producer (runs, cuts, ...)
+//   Variables      TNamed, simulation variable names in production order, comma separated
+//   <simVar>/hSim, <simVar>/hDataSubDummy, <simVar>/hRatio   TH1D, one directory per variable
+#ifndef COMPARISON_PLOT_FILE_H
+#define COMPARISON_PLOT_FILE_H
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TH1D.h"
+#include "TNamed.h"
+#include "TObjArray.h"
+#include "TObjString.h"
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TString.h"
+#include "FileStamp.h"
+#include "ParallelRuns.h"
+#include "PlotComparisonAndRatio.h"
+
+const int kComparisonPlotFormatVersion = 1;
+
+inline const char* DefaultComparisonPlotPath() { return "./PLOT_OUTPUT/DataVsSim_coin.root"; }
+
+class ComparisonPlotWriter {
+public:
+  ComparisonPlotWriter(const std::string& Path, const std::string& Provenance)
+    : fPath(Path), fTmp(Path + CacheTmpSuffix()), fProvenance(Provenance) {
+    gSystem->mkdir(gSystem->GetDirName(Path.c_str()).Data(), true);
+    fFile.reset(TFile::Open(fTmp.c_str(), "RECREATE"));
+    if (!fFile || fFile->IsZombie()) { std::cerr << "[ERROR] Cannot write " << fTmp << "\n"; fFile.reset(); }
+  }
+  ~ComparisonPlotWriter() { Close(); }
+  ComparisonPlotWriter(const ComparisonPlotWriter&) = delete;
+  ComparisonPlotWriter& operator=(const ComparisonPlotWriter&) = delete;
+
+  bool IsOpen() const { return fFile != nullptr; }
+  const std::string& Path() const { return fPath; }
+
+  // Write the final histograms of one variable (the histograms are not modified or adopted)
+  bool Add(const std::string& SimVar, const TH1D* hSim, const TH1D* hDataSubDummy, const TH1D* hRatio) {
+    if (!fFile || !hSim || !hDataSubDummy || !hRatio) return false;
+    TDirectory* D = fFile->mkdir(SimVar.c_str());
+    if (!D) { std::cerr << "[ERROR] Variable " << SimVar << " written twice to " << fPath << "\n"; return false; }
+    D->WriteTObject(hSim, "hSim");
+    D->WriteTObject(hDataSubDummy, "hDataSubDummy");
+    D->WriteTObject(hRatio, "hRatio");
+    fVariables.push_back(SimVar);
+    return true;
+  }
+
+  // Write the header objects and move the file into place
+  void Close() {
+    if (!fFile) return;
+    TString Vars;
+    for (size_t i = 0; i < fVariables.size(); ++i) Vars += (i ? "," : "") + TString(fVariables[i].c_str());
+    TNamed Version("FormatVersion", Form("%d", kComparisonPlotFormatVersion));
+    TNamed Provenance("Provenance", fProvenance.c_str());
+    TNamed Variables("Variables", Vars.Data());
+    fFile->WriteTObject(&Version);
+    fFile->WriteTObject(&Provenance);
+    fFile->WriteTObject(&Variables);
+    fFile->Close();
+    fFile.reset();
+    gSystem->Rename(fTmp.c_str(), fPath.c_str());
+  }
+
+private:
+  std::string fPath, fTmp, fProvenance;
+  std::unique_ptr<TFile> fFile;
+  std::vector<std::string> fVariables;
+};
+
+// Variables of a plot file (empty if it cannot be read or has another format version)
+inline std::vector<std::string> ReadComparisonPlotVariables(const std::string& Path) {
+  std::vector<std::string> Vars;
+  std::unique_ptr<TFile> F(TFile::Open(Path.c_str(), "READ"));
+  if (!F || F->IsZombie()) { std::cerr << "[ERROR] Cannot read " << Path << "\n"; return Vars; }
+  TNamed* V = (TNamed*)F->Get("FormatVersion");
+  TNamed* L = (TNamed*)F->Get("Variables");
+  if (!V || TString(V->GetTitle()).Atoi() != kComparisonPlotFormatVersion || !L) {
+    std::cerr << "[ERROR] " << Path << " is not a plot file of format version " << kComparisonPlotFormatVersion << "\n";
+    return Vars;
+  }
+  std::unique_ptr<TObjArray> Tok(TString(L->GetTitle()).Tokenize(","));
+  for (int i = 0; i < Tok->GetEntries(); ++i) Vars.push_back(((TObjString*)Tok->At(i))->GetString().Data());
+  return Vars;
+}
+
+// Draw the plot of one variable from the plot file (opened here, so this runs in any worker)
+inline bool RenderComparisonPlot(const std::string& Path, const std::string& SimVar, bool SavePdf = false) {
+  std::unique_ptr<TFile> F(TFile::Open(Path.c_str(), "READ"));
+  if (!F || F->IsZombie()) return false;
+  std::unique_ptr<TH1D> hSim((TH1D*)F->Get((SimVar + "/hSim").c_str()));
+  std::unique_ptr<TH1D> hData((TH1D*)F->Get((SimVar + "/hDataSubDummy").c_str()));
+  std::unique_ptr<TH1D> hRatio((TH1D*)F->Get((SimVar + "/hRatio").c_str()));
+  if (!hSim || !hData || !hRatio) { std::cerr << "[ERROR] Missing histograms of " << SimVar << " in " << Path << "\n"; return false; }
+  for (TH1D* h : {hSim.get(), hData.get(), hRatio.get()}) h->SetDirectory(nullptr);
+  DrawComparisonAndRatio(hSim.get(), hData.get(), hRatio.get(), SimVar, SavePdf);
+  return true;
+}
+
+// Render stage: the plots of Vars (all variables of the file if empty) in NWorkers processes.
+// Returns the number of workers with a plot that could not be drawn.
+inline int RenderComparisonPlots(const std::string& Path, int NWorkers, std::vector<std::string> Vars = {},
+                                 bool SavePdf = false) {
+  if (Vars.empty()) Vars = ReadComparisonPlotVariables(Path);
+  if (Vars.empty()) return 0;
+  const Bool_t WasBatch = gROOT->IsBatch(); // restored below, so an interactive session stays interactive
+  gROOT->SetBatch(kTRUE);
+  gSystem->mkdir("PNGs", true);
+  if (SavePdf) gSystem->mkdir("PDFs", true);
+  const int Failed = RunJobsInProcesses(Vars.size(), NWorkers, [&](size_t i) {
+    if (!RenderComparisonPlot(Path, Vars[i], SavePdf)) throw std::runtime_error("cannot render " + Vars[i]);
+  });
+  gROOT->SetBatch(WasBatch);
+  if (Failed) std::cerr << "[WARN] " << Failed << " render worker(s) failed for " << Path << "\n";
+  return Failed;
+}
+
+// Production mode for a macro's main function: while it lives, Slot points to the open writer (so
+// CombineAndPlot writes instead of drawing); on destruction the file is closed and rendered in
+// NWorkers processes.
+class ScopedDeferredRender {
+public:
+  ScopedDeferredRender(const std::string& Path, const std::string& Provenance, int NWorkers, ComparisonPlotWriter*& Slot)
+    : fWriter(Path, Provenance), fNWorkers(NWorkers), fSlot(Slot) {
+    if (fWriter.IsOpen()) fSlot = &fWriter;
+  }
+  ~ScopedDeferredRender() {
+    fSlot = nullptr;
+    if (!fWriter.IsOpen()) return;
+    fWriter.Close();
+    RenderComparisonPlots(fWriter.Path(), fNWorkers);
+  }
+private:
+  ComparisonPlotWriter fWriter;
+  int fNWorkers;
+  ComparisonPlotWriter*& fSlot;
+};
+
+#endif // COMPARISON_PLOT_FILE_H
@@ -0,0 +1,229 @@
+// CompiledCuts.h
+// Typed cut API: cuts built from C++ predicates over branch values bound with SetBranchAddress,
+// so selections run as native code instead of being interpreted by TTreeFormula per event.
+//
+// A TypedCut carries both forms of the same selection:
+//   * Title()  : the equivalent TCut string, for TTree::Project/Draw and as cache key;
+//   * Bind(B)  : a predicate bound to the branch values of one tree (BoundBranches B).
+// Cuts compose with &&, || and ! like TCut. A TypedCut made from a plain string (or TCut) is
+// the fallback: its predicate evaluates the string with TTreeFormula.
+//
+// Example:
+//   TypedCut Cut = CutRange("H.gtr.dp", -8, 8) && CutGreater("H.cal.etottracknorm", 0.7);
+//   BoundBranches B(T);
+//   auto Pass = Cut.Bind(B);
+//   for (Long64_t i=0; i<T->GetEntries(); ++i) { B.GetEntry(i); if (Pass()) ... }
+#ifndef COMPILED_CUTS_H
+#define COMPILED_CUTS_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <iostream>
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TTreeFormula.h"
+#include "TString.h"
+#include "TCut.h"
+
+// Scalar branch values of one tree, read into doubles (Double_t and Float_t leaves).
+// Only bound branches are read by GetEntry; addresses are reset again on destruction.
+class BoundBranches {
+public:
+  explicit BoundBranches(TTree* Tree) : fTree(Tree) {}
+  ~BoundBranches() {
+    if (!fTree) return;
+    for (auto& S : fSlots) if (S.Branch) fTree->ResetBranchAddress(S.Branch);
+  }
+  BoundBranches(const BoundBranches&) = delete;
+  BoundBranches& operator=(const BoundBranches&) = delete;
+
+  TTree* Tree() const { return fTree; }
+
+  // Make Value readable as Name (Bind, BindValue, compiled cuts) if Name is no branch of the
+  // tree, e.g. a column computed per entry (ComputedColumns). Value must outlive this object.
+  void Provide(const std::string& Name, const double* Value) { fProvided[Name] = Value; }
+  const double* Provided(const std::string& Name) const {
+    auto it = fProvided.find(Name);
+    return it != fProvided.end() ? it->second : nullptr;
+  }
+
+  // Pointer to the value of branch Name for the current entry (stable for the object lifetime);
+  // nullptr if the branch does not exist or is not a Double_t/Float_t scalar.
+  const double* Bind(const std::string& Name) {
+    auto it = fIndex.find(Name);
+    if (it != fIndex.end()) return &fSlots[it->second].Value;
+    if (const double* P = Provided(Name)) return P;
+
+    TBranch* Br = fTree ? fTree->GetBranch(Name.c_str()) : nullptr;
+    TLeaf*   Lf = fTree ? fTree->GetLeaf(Name.c_str())   : nullptr;
+    if (!Br || !Lf || Lf->GetLen() != 1) {
+      std::cerr << "[ERROR] BoundBranches: no scalar branch '" << Name << "'\n";
+      return nullptr;
+    }
+    // Other leaf types (Int_t, Long64_t, Bool_t, ...) cannot be read into a double or float
+    const TString Type = Lf->GetTypeName();
+    if (Type != "Double_t" && Type != "Float_t") return nullptr;
+    fSlots.emplace_back();
+    Slot& S = fSlots.back();
+    S.Branch  = Br;
+    S.IsFloat = (Type == "Float_t");
+    fTree->SetBranchStatus(Name.c_str(), 1);
+    if (S.IsFloat) fTree->SetBranchAddress(Name.c_str(), &S.FloatValue);
+    else           fTree->SetBranchAddress(Name.c_str(), &S.Value);
+    fIndex[Name] = fSlots.size() - 1;
+    return &S.Value;
+  }
+
+  // Load entry (tree entry number) and read the bound branches; false past the end
+  bool GetEntry(Long64_t Entry) {
+    Long64_t Local = fTree->LoadTree(Entry);
+    if (Local < 0) return false;
+    for (auto& S : fSlots) {
+      S.Branch->GetEntry(Local);
+      if (S.IsFloat) S.Value = S.FloatValue;
+    }
+    return true;
+  }
+
+private:
+  struct Slot { TBranch* Branch = nullptr; bool IsFloat = false; float FloatValue = 0.f; double Value = 0.0; };
+  TTree* fTree;
+  std::deque<Slot> fSlots; // deque: element addresses stay valid as slots are added
+  std::map<std::string, size_t> fIndex;
+  std::map<std::string, const double*> fProvided;
+};
+
+// Columns computed per entry from other branches: binds its inputs and provides the columns to
+// B (BoundBranches::Provide), and returns what computes them after each B.GetEntry
+typedef std::function<std::function<void()>(BoundBranches&)> ComputedColumns;
+
+// Helper: shortest text that reads back as exactly X (so Title() selects the same events)
+inline TString CutNumber(double X) {
+  TString S = TString::Format("%g", X);
+  if (S.Atof() != X) S = TString::Format("%.17g", X);
+  return S;
+}
+
+class TypedCut {
+public:
+  typedef std::function<bool()>                  Predicate;
+  typedef std::function<Predicate(BoundBranches&)> Binder;
+
+  // Empty cut: selects everything
+  TypedCut() {}
+  TypedCut(const TString& Title, Binder B) : fTitle(Title), fBinder(B) {}
+
+  // String fallback: evaluated per event by TTreeFormula
+  TypedCut(const TString& Formula) : fTitle(Formula) {
+    if (Formula.Length() == 0) return;
+    fBinder = [Formula](BoundBranches& B) -> Predicate {
+      std::shared_ptr<TTreeFormula> F(new TTreeFormula("fTypedCutFallback", Formula, B.Tree()));
+      if (F->GetNdim() == 0) {
+        std::cerr << "[ERROR] TypedCut: cannot compile '" << Formula << "'\n";
+        return [] { return false; };
+      }
+      return [F] { return F->GetNdata() > 0 && F->EvalInstance(0) != 0.0; };
+    };
+  }
+  TypedCut(const char* Formula) : TypedCut(TString(Formula ? Formula : "")) {}
+  TypedCut(const TCut& Cut) : TypedCut(TString(Cut.GetTitle())) {}
+
+  bool IsEmpty() const { return !fBinder; }
+  const TString& Title() const { return fTitle; }
+  TCut AsTCut() const { return TCut(fTitle.Data()); }
+
+  // Predicate for the current entry of B's tree (call B.GetEntry first)
+  Predicate Bind(BoundBranches& B) const {
+    if (!fBinder) return [] { return true; };
+    return fBinder(B);
+  }
+
+  friend TypedCut operator&&(const TypedCut& A, const TypedCut& C) {
+    if (A.IsEmpty()) return C;
+    if (C.IsEmpty()) return A;
+    Binder BA = A.fBinder, BC = C.fBinder;
+    return TypedCut(TString::Format("(%s)&&(%s)", A.fTitle.Data(), C.fTitle.Data()),
+                    [BA, BC](BoundBranches& B) -> Predicate {
+                      Predicate PA = BA(B), PC = BC(B);
+                      return [PA, PC] { return PA() && PC(); };
+                    });
+  }
+  friend TypedCut operator||(const TypedCut& A, const TypedCut& C) {
+    if (A.IsEmpty() || C.IsEmpty()) return TypedCut();
+    Binder BA = A.fBinder, BC = C.fBinder;
+    return TypedCut(TString::Format("(%s)||(%s)", A.fTitle.Data(), C.fTitle.Data()),
+                    [BA, BC](BoundBranches& B) -> Predicate {
+                      Predicate PA = BA(B), PC = BC(B);
+                      return [PA, PC] { return PA() || PC(); };
+                    });
+  }
+  friend TypedCut operator!(const TypedCut& A) {
+    Binder BA = A.fBinder;
+    if (!BA) return TypedCut("0", [](BoundBranches&) -> Predicate { return [] { return false; }; });
+    return TypedCut(TString::Format("!(%s)", A.fTitle.Data()),
+                    [BA](BoundBranches& B) -> Predicate {
+                      Predicate PA = BA(B);
+                      return [PA] { return !PA(); };
+                    });
+  }
+
+private:
+  TString fTitle;
+  Binder  fBinder;
+};
+
+// Cut on one branch value: Title is "(Var<Op>X)" and Pred(value) is the compiled test
+// (branches that Bind cannot read as a double are evaluated from Title by TTreeFormula)
+template <class Compare>
+inline TypedCut CutOnBranch(const char* Var, const char* Op, double X, Compare Pred) {
+  std::string Name(Var);
+  TString Title = TString::Format("(%s%s%s)", Var, Op, CutNumber(X).Data());
+  return TypedCut(Title,
+                  [Name, Title, X, Pred](BoundBranches& B) -> TypedCut::Predicate {
+                    const double* V = B.Bind(Name);
+                    if (!V) return TypedCut(Title).Bind(B); // not a Double_t/Float_t scalar: TTreeFormula
+                    return [V, X, Pred] { return Pred(*V, X); };
+                  });
+}
+
+inline TypedCut CutGreater(const char* Var, double X)   { return CutOnBranch(Var, ">",  X, [](double v, double x) { return v >  x; }); }
+inline TypedCut CutGreaterEq(const char* Var, double X) { return CutOnBranch(Var, ">=", X, [](double v, double x) { return v >= x; }); }
+inline TypedCut CutLess(const char* Var, double X)      { return CutOnBranch(Var, "<",  X, [](double v, double x) { return v <  x; }); }
+inline TypedCut CutLessEq(const char* Var, double X)    { return CutOnBranch(Var, "<=", X, [](double v, double x) { return v <= x; }); }
+
+// Open interval Lo < Var < Hi
+inline TypedCut CutRange(const char* Var, double Lo, double Hi) {
+  return CutGreater(Var, Lo) && CutLess(Var, Hi);
+}
+
+// Value of an expression for the current entry, false if it has no data. Plain scalar branches
+// are read through B (native); anything else (e.g. "P.gtr.p/H.kin.primary.nu") uses TTreeFormula.
+typedef std::function<bool(double&)> ValueReader;
+inline ValueReader BindValue(BoundBranches& B, const TString& Expr) {
+  if (const double* P = B.Provided(Expr.Data())) return [P](double& X) { X = *P; return true; };
+  TTree* T = B.Tree();
+  TLeaf* Lf = T ? T->GetLeaf(Expr) : nullptr;
+  if (T && T->GetBranch(Expr) && Lf && Lf->GetLen() == 1) {
+    TString Type = Lf->GetTypeName();
+    if (Type == "Double_t" || Type == "Float_t") {
+      const double* V = B.Bind(Expr.Data());
+      if (V) return [V](double& X) { X = *V; return true; };
+    }
+  }
+  std::shared_ptr<TTreeFormula> F(new TTreeFormula("fBoundValue", Expr, T));
+  if (F->GetNdim() == 0) {
+    std::cerr << "[ERROR] BindValue: cannot compile '" << Expr << "'\n";
+    return ValueReader();
+  }
+  return [F](double& X) {
+    if (F->GetNdata() <= 0) return false;
+    X = F->EvalInstance(0);
+    return true;
+  };
+}
+
+#endif // COMPILED_CUTS_H
@@ -0,0 +1,206 @@
+// DataVsSimConfig.h
+// Settings of DataVsSimPlot_MultiDataMultiDummy (run lists, simulation file, normalization, cuts,
+// binning, modes), read from a plain-text config file so they do not have to be edited in the
+// macro. The defaults are the values the macro used to hard-code; datavssim.conf lists them all.
+//
+// Format: one "key = value" per line; '#' starts a comment; unknown keys are an error.
+//   data_runs = 24329-24332            run lists as in ParseRunsList ("a,b,c-d")
+//   bins.z    = 300, 0.0, 1.0          nbins, xmin, xmax of one variable
+#ifndef DATA_VS_SIM_CONFIG_H
+#define DATA_VS_SIM_CONFIG_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "TString.h"
+#include "CompiledCuts.h"
+
+//----------------------------------------------------------------
+// ParseRunsList: "24329,24332-24334" → {24329,24332,24333,24334}
+//----------------------------------------------------------------
+inline std::vector<int> ParseRunsList(const std::string &CsvLike) {
+  std::vector<int> Runs; Runs.reserve(64);
+  if (CsvLike.empty()) return Runs;
+  std::stringstream SS(CsvLike);
+  std::string Tok;
+  while (std::getline(SS, Tok, ',')) {
+    if (Tok.empty()) continue;
+    auto Dash = Tok.find('-');
+    if (Dash != std::string::npos) {
+      int A = std::stoi(Tok.substr(0, Dash));
+      int B = std::stoi(Tok.substr(Dash + 1));
+      if (B < A) std::swap(A, B);
+      for (int R = A; R <= B; ++R) Runs.push_back(R);
+    } else {
+      Runs.push_back(std::stoi(Tok));
+    }
+  }
+  return Runs;
+}
+
+struct VarBinning { int nbins; double xmin; double xmax; };
+
+struct DataVsSimSettings {
+  std::string SimFile = "./simc_worksim/coin_7p87deg_3p632gev_hyd_rsidis.root";
+  // Electron data/dummy runs, positron data/dummy runs
+  std::vector<int> DataRuns     = {24329, 24330, 24331, 24332};
+  std::vector<int> DummyRuns    = {24335, 24336, 24337, 24338};
+  std::vector<int> PosDataRuns  = {24603, 24603};
+  std::vector<int> PosDummyRuns = {24601, 24601};
+
+  double NormFac = 0.842205E+11;          // Miscellaneous section of the respective .hist file
+  double WallThicknessRatio = 3.82;       // Dummy_thickness / Data_thickness
+  std::string SimCuts = "((hsdelta>-8.0) && (hsdelta<8))";
+
+  // HMS cuts on data and dummy (compiled, BuildDnDCuts), and any extra cut formula
+  double HmsDpMin = -8.0, HmsDpMax = 8.0;
+  double HmsEtotTrackNormMin = 0.7;
+  double HmsNpeSumMin = 2.0;
+  std::string ExtraCuts;
+
+  // Variables in plotting order, and the binning of each
+  std::vector<std::string> Variables = {"hsdelta", "hsytar", "hsxptar", "hsyptar",
+                                        "ssdelta", "ssytar", "ssxptar", "ssyptar",
+                                        "z", "xbj", "Q2", "W", "nu", "epsilon", "thetapq", "phipq"};
+  std::map<std::string, VarBinning> Bins = {
+    {"hsdelta", {300, -12.0, 12.0}},  {"hsytar", {300, -5.0, 5.0}},
+    {"hsxptar", {300, -0.25, 0.25}},  {"hsyptar", {300, -0.25, 0.25}},
+    {"ssdelta", {300, -25.0, 25.0}},  {"ssytar", {300, -5.0, 5.0}},
+    {"ssxptar", {300, -1.0, 1.0}},    {"ssyptar", {300, -1.0, 1.0}},
+    {"z", {300, 0.0, 1.0}},           {"xbj", {300, 0.0, 1.0}},
+    {"Q2", {300, 0.0, 12.0}},         {"W", {300, 0.0, 4.5}},
+    {"nu", {300, 0.0, 8.0}},          {"epsilon", {300, 0.0, 1.0}},
+    {"thetapq", {300, 0.0, 0.3}},     {"phipq", {300, 0.0, 7.0}},
+  };
+
+  int    Threads = 0;          // runs projected at once; 0 = one per core
+  int    PrefetchDepth = 1;    // runs opened and read ahead of the one projected; 0 = none
+  bool   SinglePass = true;    // read each run's tree once for all variables
+  bool   UseSkims = true;      // per-run skims (./SKIMS)
+  bool   DeferRender = true;   // production file + render stage (./PLOT_OUTPUT)
+  double MaxResidentMB = 0;    // resident-memory ceiling; 0 = RP_MAX_RSS_MB or none
+};
+
+// Data/dummy cuts of the settings, as native predicates
+inline TypedCut BuildDnDCuts(const DataVsSimSettings& S) {
+  TypedCut Cuts = CutRange("H.gtr.dp", S.HmsDpMin, S.HmsDpMax) && CutGreater("H.cal.etottracknorm", S.HmsEtotTrackNormMin)
+               && CutGreater("H.cer.npeSum", S.HmsNpeSumMin);
+  if (!S.ExtraCuts.empty()) Cuts = Cuts && TypedCut(S.ExtraCuts.c_str());
+  return Cuts;
+}
+
+// Helper: split "a, b, c" at commas, trimming blanks
+inline std::vector<std::string> SplitConfigList(const std::string& Value) {
+  std::vector<std::string> Out;
+  std::stringstream SS(Value);
+  for (std::string Tok; std::getline(SS, Tok, ',');) {
+    TString T(Tok.c_str());
+    T = T.Strip(TString::kBoth);
+    if (T.Length()) Out.push_back(T.Data());
+  }
+  return Out;
+}
+
+// Read the settings of Path over S (keys not in the file keep their value); false on any error
+inline bool LoadDataVsSimSettings(const std::string& Path, DataVsSimSettings& S) {
+  std::ifstream In(Path);
+  if (!In) { std::cerr << "[ERROR] Cannot read config file " << Path << "\n"; return false; }
+  bool Ok = true;
+  int LineNo = 0;
+  for (std::string Line; std::getline(In, Line);) {
+    ++LineNo;
+    const size_t Hash = Line.find('#');
+    if (Hash != std::string::npos) Line.erase(Hash);
+    TString L(Line.c_str());
+    L = L.Strip(TString::kBoth);
+    if (L.Length() == 0) continue;
+    const Ssiz_t Eq = L.Index("=");
+    if (Eq == kNPOS) { std::cerr << "[ERROR] " << Path << ":" << LineNo << ": expected key = value\n"; Ok = false; continue; }
+    const std::string Key   = TString(TString(L(0, Eq)).Strip(TString::kBoth)).Data();
+    const std::string Value = TString(TString(L(Eq + 1, L.Length() - Eq - 1)).Strip(TString::kBoth)).Data();
+    const std::vector<std::string> List = SplitConfigList(Value);
+    auto Bool = [&](bool& B) { B = (Value == "1" || Value == "true" || Value == "yes"); };
+    try {
+      if      (Key == "sim_file")              S.SimFile = Value;
+      else if (Key == "data_runs")             S.DataRuns = ParseRunsList(Value);
+      else if (Key == "dummy_runs")            S.DummyRuns = ParseRunsList(Value);
+      else if (Key == "pos_data_runs")         S.PosDataRuns = ParseRunsList(Value);
+      else if (Key == "pos_dummy_runs")        S.PosDummyRuns = ParseRunsList(Value);
+      else if (Key == "normfac")               S.NormFac = std::stod(Value);
+      else if (Key == "wall_thickness_ratio")  S.WallThicknessRatio = std::stod(Value);
+      else if (Key == "sim_cuts")              S.SimCuts = Value;
+      else if (Key == "hms_dp" && List.size() == 2) { S.HmsDpMin = std::stod(List[0]); S.HmsDpMax = std::stod(List[1]); }
+      else if (Key == "hms_etottracknorm_min") S.HmsEtotTrackNormMin = std::stod(Value);
+      else if (Key == "hms_npesum_min")        S.HmsNpeSumMin = std::stod(Value);
+      else if (Key == "extra_cuts")            S.ExtraCuts = Value;
+      else if (Key == "variables")             S.Variables = List;
+      else if (Key.compare(0, 5, "bins.") == 0 && List.size() == 3)
+        S.Bins[Key.substr(5)] = {std::stoi(List[0]), std::stod(List[1]), std::stod(List[2])};
+      else if (Key == "threads")               S.Threads = std::stoi(Value);
+      else if (Key == "prefetch_depth")        S.PrefetchDepth = std::stoi(Value);
+      else if (Key == "single_pass")           Bool(S.SinglePass);
+      else if (Key == "use_skims")             Bool(S.UseSkims);
+      else if (Key == "defer_render")          Bool(S.DeferRender);
+      else if (Key == "max_rss_mb")            S.MaxResidentMB = std::stod(Value);
+      else { std::cerr << "[ERROR] " << Path << ":" << LineNo << ": unknown or malformed key '" << Key << "'\n"; Ok = false; }
+    } catch (const std::exception&) {
+      std::cerr << "[ERROR] " << Path << ":" << LineNo << ": bad value for '" << Key << "': " << Value << "\n";
+      Ok = false;
+    }
+  }
+  for (const auto& V : S.Variables) {
+    if (!S.Bins.count(V)) { std::cerr << "[ERROR] " << Path << ": no bins." << V << " for variable " << V << "\n"; Ok = false; }
+  }
+  return Ok;
+}
+
+// Write S in the config file format (e.g. as a template for a new config file)
+inline void WriteDataVsSimSettings(std::ostream& Out, const DataVsSimSettings& S) {
+  auto Runs = [](const std::vector<int>& R) {
+    std::string T;
+    for (size_t i = 0; i < R.size(); ++i) T += (i ? "," : "") + std::to_string(R[i]);
+    return T;
+  };
+  Out << "sim_file = " << S.SimFile << "\n"
+      << "data_runs = " << Runs(S.DataRuns) << "\n"
+      << "dummy_runs = " << Runs(S.DummyRuns) << "\n"
+      << "pos_data_runs = " << Runs(S.PosDataRuns) << "\n"
+      << "pos_dummy_runs = " << Runs(S.PosDummyRuns) << "\n"
+      << "normfac = " << CutNumber(S.NormFac) << "\n"
+      << "wall_thickness_ratio = " << CutNumber(S.WallThicknessRatio) << "\n"
+      << "sim_cuts = " << S.SimCuts << "\n"
+      << "hms_dp = " << CutNumber(S.HmsDpMin) << ", " << CutNumber(S.HmsDpMax) << "\n"
+      << "hms_etottracknorm_min = " << CutNumber(S.HmsEtotTrackNormMin) << "\n"
+      << "hms_npesum_min = " << CutNumber(S.HmsNpeSumMin) << "\n"
+      << "extra_cuts = " << S.ExtraCuts << "\n"
+      << "variables = ";
+  for (size_t i = 0; i < S.Variables.size(); ++i) Out << (i ? "," : "") << S.Variables[i];
+  Out << "\n";
+  for (const auto& V : S.Variables) {
+    auto it = S.Bins.find(V);
+    if (it != S.Bins.end())
+      Out << "bins." << V << " = " << it->second.nbins << ", " << CutNumber(it->second.xmin) << ", " << CutNumber(it->second.xmax) << "\n";
+  }
+  Out << "threads = " << S.Threads << "\n"
+      << "prefetch_depth = " << S.PrefetchDepth << "\n"
+      << "single_pass = " << int(S.SinglePass) << "\n"
+      << "use_skims = " << int(S.UseSkims) << "\n"
+      << "defer_render = " << int(S.DeferRender) << "\n"
+      << "max_rss_mb = " << CutNumber(S.MaxResidentMB) << "\n";
+}
+
+// The analysis itself: DataVsSimPlot_MultiDataMultiDummy.C (macro, or libRPAnalysis.so via the Makefile)
+void RunDataVsSimPlot(const DataVsSimSettings& S);
+// Sharded execution of the same analysis (RunShards.h): one shard, the merge, or both on this machine
+bool RunDataVsSimShard(const DataVsSimSettings& S, int Shard, int NShards, const std::string& Dir);
+bool MergeDataVsSimShards(const DataVsSimSettings& S, int NShards, const std::string& Dir);
+bool RunDataVsSimSharded(const DataVsSimSettings& S, int NShards, int NProcs, const std::string& Dir);
+// Follow mode: one run followed while its replay file is still being written (LiveFollow.h)
+bool FollowDataVsSimRun(const DataVsSimSettings& S, int LiveRun, int PollSeconds, int IdlePolls);
+
+#endif // DATA_VS_SIM_CONFIG_H
@@ -0,0 +1,166 @@
+// DerivedColumns.h
+// Composite kinematics computed once per input file into a friend tree, so projections read
+// plain Double_t branches instead of evaluating a TTreeFormula expression per event.
+//
+// Columns (each with a validity flag, 1 = valid, 0 = the value must not be used):
+//   rp_z      P.gtr.p/H.kin.primary.nu                     valid if nu > 0
+//   rp_phipq  P.kin.secondary.ph_xq wrapped to [0, 2pi]    valid if ph_xq is finite
+//   rp_pt     P.gtr.p*sin(P.kin.secondary.th_xq)           valid if p and th_xq are finite
+// Values are computed in double precision exactly like the former TTreeFormula expressions.
+// Files that are still being written get the same columns per entry (DerivedColumnsPerEntry).
+//
+// File  : ./DERIVED/<input file name>.derived.root, tree "D" (same entries as the input tree "T").
+// Valid : while the input file (replay file or skim) keeps its mtime and size.
+#ifndef DERIVED_COLUMNS_H
+#define DERIVED_COLUMNS_H
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "TFile.h"
+#include "TFriendElement.h"
+#include "TMath.h"
+#include "TNamed.h"
+#include "TSystem.h"
+#include "TTree.h"
+#include "TString.h"
+#include "FileStamp.h"
+#include "CompiledCuts.h"
+
+// One derived column: its branch and its flag branch
+struct DerivedColumn {
+  std::string Name;
+  std::string Flag;
+};
+
+inline const std::vector<DerivedColumn>& DerivedColumns() {
+  static const std::vector<DerivedColumn> Columns = {
+    {"rp_z", "rp_z_ok"}, {"rp_phipq", "rp_phipq_ok"}, {"rp_pt", "rp_pt_ok"},
+  };
+  return Columns;
+}
+
+// Helper: validity cut of a variable if it is a derived column (empty cut otherwise)
+inline TypedCut DerivedValidCut(const std::string& Var) {
+  for (const auto& C : DerivedColumns())
+    if (C.Name == Var) return CutGreater(C.Flag.c_str(), 0);
+  return TypedCut();
+}
+
+// Helper: friend file of an input file
+inline std::string DerivedPath(const std::string& SrcPath, const std::string& Dir = "./DERIVED") {
+  return Dir + "/" + gSystem->BaseName(SrcPath.c_str()) + ".derived.root";
+}
+
+// Helper: key of the input file the friend was computed from
+inline TString DerivedKey(const std::string& SrcPath) {
+  Long_t Mtime = 0; Long64_t Size = 0;
+  if (!GetFileStamp(SrcPath, Mtime, Size)) return "";
+  return TString::Format("%ld %lld v1", Mtime, Size);
+}
+
+// Helper: the input branches the derived columns are computed from
+inline const std::vector<std::string>& DerivedColumnInputs() {
+  static const std::vector<std::string> Inputs = {
+    "P.gtr.p", "H.kin.primary.nu", "P.kin.secondary.ph_xq", "P.kin.secondary.th_xq",
+  };
+  return Inputs;
+}
+
+// The derived columns of the entry loaded in B, computed from its input branches (missing
+// inputs give invalid columns)
+class DerivedColumnValues {
+public:
+  explicit DerivedColumnValues(BoundBranches& B) {
+    TTree* T = B.Tree();
+    auto Bind = [&](const char* N) { return (T && T->GetBranch(N)) ? B.Bind(N) : nullptr; };
+    const auto& In = DerivedColumnInputs();
+    fP    = Bind(In[0].c_str());
+    fNu   = Bind(In[1].c_str());
+    fPhXq = Bind(In[2].c_str());
+    fThXq = Bind(In[3].c_str());
+  }
+
+  // Columns of the loaded entry
+  void Compute() {
+    ZOk   = (fP && fNu && *fNu > 0) ? 1 : 0;
+    Z     = ZOk ? *fP / *fNu : 0.0;
+    PhiOk = (fPhXq && std::isfinite(*fPhXq)) ? 1 : 0;
+    Phi   = PhiOk ? (*fPhXq < 0 ? *fPhXq + 2*TMath::Pi() : *fPhXq) : 0.0;
+    PtOk  = (fP && fThXq && std::isfinite(*fP) && std::isfinite(*fThXq)) ? 1 : 0;
+    Pt    = PtOk ? *fP * std::sin(*fThXq) : 0.0;
+  }
+
+  // Columns and flags by name, as in the friend tree
+  void ProvideTo(BoundBranches& B) const {
+    B.Provide("rp_z", &Z);       B.Provide("rp_z_ok", &ZOk);
+    B.Provide("rp_phipq", &Phi); B.Provide("rp_phipq_ok", &PhiOk);
+    B.Provide("rp_pt", &Pt);     B.Provide("rp_pt_ok", &PtOk);
+  }
+
+  double Z = 0, ZOk = 0, Phi = 0, PhiOk = 0, Pt = 0, PtOk = 0;
+
+private:
+  const double *fP = nullptr, *fNu = nullptr, *fPhXq = nullptr, *fThXq = nullptr;
+};
+
+// Derived columns computed per entry instead of read from a friend file (e.g. for a replay file
+// that is still being written, whose friend file would be stale at once)
+inline ComputedColumns DerivedColumnsPerEntry() {
+  return [](BoundBranches& B) -> std::function<void()> {
+    std::shared_ptr<DerivedColumnValues> V(new DerivedColumnValues(B));
+    V->ProvideTo(B);
+    return [V] { V->Compute(); };
+  };
+}
+
+// Compute the derived columns of every entry of T (from SrcPath) into OutPath (tmp + rename)
+inline bool MakeDerivedColumns(TTree* T, const std::string& SrcPath, const std::string& OutPath) {
+  const TString Key = DerivedKey(SrcPath);
+  if (!T || Key.IsNull()) return false;
+  gSystem->mkdir(gSystem->GetDirName(OutPath.c_str()).Data(), true);
+
+  BoundBranches B(T);
+  DerivedColumnValues V(B);
+
+  const std::string Tmp = OutPath + CacheTmpSuffix();
+  std::unique_ptr<TFile> Out(TFile::Open(Tmp.c_str(), "RECREATE"));
+  if (!Out || Out->IsZombie()) { std::cerr << "[WARN] Cannot write " << Tmp << "\n"; return false; }
+  TTree* D = new TTree("D", "derived columns"); // owned by Out
+  D->Branch("rp_z", &V.Z, "rp_z/D");           D->Branch("rp_z_ok", &V.ZOk, "rp_z_ok/D");
+  D->Branch("rp_phipq", &V.Phi, "rp_phipq/D"); D->Branch("rp_phipq_ok", &V.PhiOk, "rp_phipq_ok/D");
+  D->Branch("rp_pt", &V.Pt, "rp_pt/D");        D->Branch("rp_pt_ok", &V.PtOk, "rp_pt_ok/D");
+
+  const Long64_t N = T->GetEntries();
+  for (Long64_t i = 0; i < N; ++i) {
+    if (!B.GetEntry(i)) break;
+    V.Compute();
+    D->Fill();
+  }
+  D->Write();
+  TNamed("DerivedKey", Key.Data()).Write();
+  Out->Close();
+  gSystem->Rename(Tmp.c_str(), OutPath.c_str());
+  return true;
+}
+
+// Add the derived columns to T (read from the file SrcPath) as friend "D", computing them first
+// if the friend file is missing or stale. The friend file is owned and closed by T.
+// Returns false (T unchanged) if they cannot be provided.
+inline bool AttachDerivedColumns(TTree* T, const std::string& SrcPath, const std::string& Dir = "./DERIVED") {
+  if (!T) return false;
+  const std::string Path = DerivedPath(SrcPath, Dir);
+  bool Fresh = false;
+  if (!gSystem->AccessPathName(Path.c_str())) {
+    std::unique_ptr<TFile> F(TFile::Open(Path.c_str(), "READ"));
+    TNamed* K = (F && !F->IsZombie()) ? (TNamed*)F->Get("DerivedKey") : nullptr;
+    TTree*  D = (F && !F->IsZombie()) ? (TTree*)F->Get("D") : nullptr;
+    Fresh = K && D && D->GetEntries() == T->GetEntries() && TString(K->GetTitle()) == DerivedKey(SrcPath);
+  }
+  if (!Fresh && !MakeDerivedColumns(T, SrcPath, Path)) return false;
+  return T->AddFriend("D", Path.c_str()) != nullptr;
+}
+
+#endif // DERIVED_COLUMNS_H
@@ -0,0 +1,174 @@
+// EntryListCache.h
+// Persistent selections: the entries of a tree that pass a selection, found once per input file
+// and selection and kept on disk, so later projections visit only the survivors. TTree::Project
+// and the single-pass fill engine (FillRandomSubtractedOutputs) both honour TTree::SetEntryList.
+// Weighted selections (SIMC: cuts * Weight * normfac) also keep each survivor's weight, so
+// one-pass fills do not evaluate the weight formula again.
+//
+// The survivors are a superset of what each projection selects (the projection still applies its
+// full cuts), and entries are visited in the original order, so the histograms do not change.
+//
+// File  : ./ENTRY_LISTS/<input file name>.<tree>.<selection hash>.root
+//   S             TTree, entry/L = tree entry of each survivor (ascending), w/D = its weight (weighted)
+//   EntryListKey  TNamed, mtime, size, tree and selection of the input it was made from
+// Valid : while the input file keeps its mtime and size.
+#ifndef ENTRY_LIST_CACHE_H
+#define ENTRY_LIST_CACHE_H
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "TEntryList.h"
+#include "TFile.h"
+#include "TNamed.h"
+#include "TSystem.h"
+#include "TTree.h"
+#include "TTreeFormula.h"
+#include "TString.h"
+#include "FileStamp.h"
+#include "CompiledCuts.h"
+#include "CoincidenceRandomSubtraction.h"
+
+struct EntrySelection {
+  std::vector<Long64_t> Entries;     // survivors, ascending
+  std::vector<double>   Weights;     // weight of each survivor (weighted selections only)
+  std::unique_ptr<TEntryList> List;  // the survivors as an entry list, for TTree::SetEntryList
+  Long64_t NTree = 0;                // entries of the tree
+
+  bool IsAll() const { return Long64_t(Entries.size()) == NTree; }
+};
+
+// Scan of a tree: appends the survivors (and their weights, if Weights is not null) in entry order
+typedef std::function<bool(TTree* T, std::vector<Long64_t>& Entries, std::vector<double>* Weights)> EntryScan;
+
+// Helper: cache file of a selection on the tree of SrcPath
+inline std::string EntryListPath(const std::string& SrcPath, const char* TreeName, const TString& Selection,
+                                 const std::string& Dir = "./ENTRY_LISTS") {
+  return Dir + "/" + gSystem->BaseName(SrcPath.c_str()) + Form(".%s.%08x.root", TreeName, Selection.Hash());
+}
+
+// Helper: key of the input a cache file was made from (empty if the input cannot be stat'ed)
+inline TString EntryListKey(const std::string& SrcPath, const char* TreeName, const TString& Selection) {
+  Long_t Mtime = 0; Long64_t Size = 0;
+  if (!GetFileStamp(SrcPath, Mtime, Size)) return "";
+  return TString::Format("%ld %lld %s|%s|v1", Mtime, Size, TreeName, Selection.Data());
+}
+
+// Read a cache file made with Key (false if it is missing, stale or incomplete)
+inline bool LoadEntrySelection(const std::string& Path, const TString& Key, bool Weighted, EntrySelection& Out) {
+  if (gSystem->AccessPathName(Path.c_str())) return false;
+  std::unique_ptr<TFile> F(TFile::Open(Path.c_str(), "READ"));
+  if (!F || F->IsZombie()) return false;
+  TNamed* K = (TNamed*)F->Get("EntryListKey");
+  TTree*  S = (TTree*)F->Get("S");
+  if (!K || !S || Key != K->GetTitle() || (Weighted && !S->GetBranch("w"))) return false;
+  Long64_t Entry = 0; double W = 0.0;
+  S->SetBranchAddress("entry", &Entry);
+  if (Weighted) S->SetBranchAddress("w", &W);
+  const Long64_t N = S->GetEntries();
+  Out.Entries.resize(N);
+  if (Weighted) Out.Weights.resize(N);
+  for (Long64_t i = 0; i < N; ++i) {
+    if (S->GetEntry(i) <= 0) return false;
+    Out.Entries[i] = Entry;
+    if (Weighted) Out.Weights[i] = W;
+  }
+  return true;
+}
+
+// Write a cache file (tmp + rename)
+inline bool WriteEntrySelection(const std::string& Path, const TString& Key, const EntrySelection& Sel, bool Weighted) {
+  gSystem->mkdir(gSystem->GetDirName(Path.c_str()).Data(), true);
+  const std::string Tmp = Path + CacheTmpSuffix();
+  std::unique_ptr<TFile> F(TFile::Open(Tmp.c_str(), "RECREATE"));
+  if (!F || F->IsZombie()) { std::cerr << "[WARN] Cannot write " << Tmp << "\n"; return false; }
+  TTree* S = new TTree("S", "selected entries"); // owned by F
+  Long64_t Entry = 0; double W = 0.0;
+  S->Branch("entry", &Entry, "entry/L");
+  if (Weighted) S->Branch("w", &W, "w/D");
+  for (size_t i = 0; i < Sel.Entries.size(); ++i) {
+    Entry = Sel.Entries[i];
+    if (Weighted) W = Sel.Weights[i];
+    S->Fill();
+  }
+  S->Write();
+  TNamed("EntryListKey", Key.Data()).Write();
+  F->Close();
+  return gSystem->Rename(Tmp.c_str(), Path.c_str()) == 0;
+}
+
+// Survivors of Selection on T (the tree of the file SrcPath): from the cache file if it is fresh,
+// otherwise from Scan (then written to the cache). False if neither works; T is not changed.
+inline bool GetEntrySelection(TTree* T, const std::string& SrcPath, const TString& Selection, bool Weighted,
+                              const EntryScan& Scan, EntrySelection& Out, const std::string& Dir = "./ENTRY_LISTS") {
+  if (!T) return false;
+  const TString Key = EntryListKey(SrcPath, T->GetName(), Selection);
+  if (Key.IsNull()) return false;
+  const std::string Path = EntryListPath(SrcPath, T->GetName(), Selection, Dir);
+  Out = EntrySelection();
+  Out.NTree = T->GetEntries();
+  if (!LoadEntrySelection(Path, Key, Weighted, Out)) {
+    Out.Entries.clear(); Out.Weights.clear();
+    if (!Scan(T, Out.Entries, Weighted ? &Out.Weights : nullptr)) return false;
+    WriteEntrySelection(Path, Key, Out, Weighted); // only a cache: a failed write is not fatal
+  }
+  Out.List.reset(new TEntryList(T));
+  Out.List->SetDirectory(nullptr);
+  for (Long64_t E : Out.Entries) Out.List->Enter(E);
+  return true;
+}
+
+// Data/dummy trees: entries passing the base cuts and the wide CT gate (every projection of the
+// run selects a subset of these: CT peak search, coincidence and random windows)
+inline bool SelectDnDEntries(TTree* T, const std::string& SrcPath, const TypedCut& BaseCuts,
+                             const CoincidenceConfig& Config, EntrySelection& Out) {
+  const TString Selection = CombineCutsAND(BaseCuts.Title(),
+                                           BuildRangeCut(Config.CtBranchName, Config.WideWindowMinNs, Config.WideWindowMaxNs));
+  return GetEntrySelection(T, SrcPath, Selection, false, [&](TTree* Tree, std::vector<Long64_t>& Entries, std::vector<double>*) {
+    BoundBranches B(Tree);
+    TypedCut::Predicate Pass = BaseCuts.Bind(B);
+    ValueReader ReadCt = BindValue(B, Config.CtBranchName);
+    if (!Pass || !ReadCt) return false;
+    const double Lo = RangeCutEdge(Config.WideWindowMinNs), Hi = RangeCutEdge(Config.WideWindowMaxNs);
+    const Long64_t N = Tree->GetEntries();
+    for (Long64_t i = 0; i < N; ++i) {
+      if (!B.GetEntry(i)) break;
+      double Ct = 0.0;
+      if (Pass() && ReadCt(Ct) && Ct > Lo && Ct < Hi) Entries.push_back(i);
+    }
+    return true;
+  }, Out);
+}
+
+// Weighted trees (SIMC h10): entries whose weight expression (cuts times weight, as given to
+// TTree::Project) is non-zero, with that weight; the other entries do not fill anything
+inline bool SelectWeightedEntries(TTree* T, const std::string& SrcPath, const TString& WeightExpr, EntrySelection& Out) {
+  return GetEntrySelection(T, SrcPath, WeightExpr, true, [&](TTree* Tree, std::vector<Long64_t>& Entries, std::vector<double>* Weights) {
+    std::unique_ptr<TTreeFormula> F(new TTreeFormula("fSelectWeight", WeightExpr, Tree));
+    if (F->GetNdim() == 0) return false;
+    const Long64_t N = Tree->GetEntries();
+    for (Long64_t i = 0; i < N; ++i) {
+      if (Tree->LoadTree(i) < 0) break;
+      double W = 0.0;
+      if (!EvalFirstInstance(F.get(), W) || W == 0.0) continue;
+      Entries.push_back(i);
+      Weights->push_back(W);
+    }
+    return true;
+  }, Out);
+}
+
+// Entry list set on a tree for the lifetime of this object (nothing set for a null list)
+class ScopedEntryList {
+public:
+  ScopedEntryList(TTree* T, TEntryList* L) : fTree(L ? T : nullptr) { if (fTree) fTree->SetEntryList(L); }
+  ~ScopedEntryList() { if (fTree) fTree->SetEntryList(nullptr); }
+  ScopedEntryList(const ScopedEntryList&) = delete;
+  ScopedEntryList& operator=(const ScopedEntryList&) = delete;
+private:
+  TTree* fTree;
+};
+
+#endif // ENTRY_LIST_CACHE_H
@@ -0,0 +1,27 @@
+// FileStamp.h
+// Modification time and size of input files, used to invalidate on-disk caches.
+#ifndef FILE_STAMP_H
+#define FILE_STAMP_H
+
+#include <functional>
+#include <string>
+#include <thread>
+#include "TSystem.h"
+#include "TString.h"
+
+// Helper: modification time and size of a file (false if it cannot be stat'ed)
+inline bool GetFileStamp(const std::string& Path, Long_t& Mtime, Long64_t& Size) {
+  FileStat_t St;
+  if (gSystem->GetPathInfo(Path.c_str(), St) != 0) return false;
+  Mtime = St.fMtime;
+  Size  = St.fSize;
+  return true;
+}
+
+// Helper: suffix of a cache's temporary file, unique per process and thread (the same cache file
+// may be rebuilt by two prefetch threads or shard workers at once; the last rename wins)
+inline std::string CacheTmpSuffix() {
+  return Form(".tmp.%d.%zu", gSystem->GetPid(), std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+#endif // FILE_STAMP_H
@@ -0,0 +1,174 @@
+// Instrumentation.h
+// Per-stage wall-clock timers and per-tree I/O counters, summarized as JSON and CSV at the end
+// of a macro. Off by default: enable with SetInstrumentation(true) or RP_INSTRUMENT=1 in the
+// environment. When off, a timer is one atomic load and nothing is recorded.
+//
+//   { ScopedStageTimer t("ct_peak", Form("run=%d", run)); ... }     // time a stage
+//   ScopedTreeIO io(tree, Form("run=%d/var=%s", run, var));            // bytes read, unzip time
+//   ScopedInstrumentationSummary s("./INSTRUMENTATION/coin");          // in main: writes coin.json/.csv
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "TSystem.h"
+#include "TTree.h"
+#include "TTreePerfStats.h"
+
+// Helper: on/off switch (initialized from RP_INSTRUMENT on first use)
+inline std::atomic<int>& InstrumentationFlag() {
+  static std::atomic<int> Flag(-1);
+  return Flag;
+}
+inline bool InstrumentationEnabled() {
+  int F = InstrumentationFlag().load(std::memory_order_relaxed);
+  if (F < 0) {
+    const char* Env = std::getenv("RP_INSTRUMENT");
+    F = (Env && Env[0] && Env[0] != '0') ? 1 : 0;
+    InstrumentationFlag().store(F, std::memory_order_relaxed);
+  }
+  return F == 1;
+}
+inline void SetInstrumentation(bool On) { InstrumentationFlag().store(On ? 1 : 0); }
+
+// Accumulated numbers of one stage (and detail, e.g. "run=24329" or "var=H.gtr.dp")
+struct StageRecord {
+  Long64_t Calls = 0;
+  double   Seconds = 0.0;
+  Long64_t BytesRead = 0;     // from TTreePerfStats (ScopedTreeIO only)
+  Long64_t ReadCalls = 0;
+  Long64_t UnzipBytes = 0;
+  double   UnzipSeconds = 0.0;
+};
+
+class InstrumentationRegistry {
+public:
+  void AddTime(const std::string& Key, double Seconds) {
+    std::lock_guard<std::mutex> Lock(fMutex);
+    StageRecord& R = fRecords[Key];
+    R.Calls++;
+    R.Seconds += Seconds;
+  }
+  void AddIO(const std::string& Key, double Seconds, Long64_t Bytes, Long64_t Reads, Long64_t UnzipBytes, double UnzipSeconds) {
+    std::lock_guard<std::mutex> Lock(fMutex);
+    StageRecord& R = fRecords[Key];
+    R.Calls++;
+    R.Seconds      += Seconds;
+    R.BytesRead    += Bytes;
+    R.ReadCalls    += Reads;
+    R.UnzipBytes   += UnzipBytes;
+    R.UnzipSeconds += UnzipSeconds;
+  }
+
+  // Write <Base>.json and <Base>.csv and print a short table
+  void Write(const std::string& Base) const {
+    std::lock_guard<std::mutex> Lock(fMutex);
+    if (fRecords.empty()) return;
+    gSystem->mkdir(gSystem->GetDirName(Base.c_str()).Data(), true);
+
+    std::ofstream Csv(Base + ".csv");
+    Csv << "stage,detail,calls,seconds,bytes_read,read_calls,unzip_bytes,unzip_seconds\n";
+    std::ofstream Json(Base + ".json");
+    Json << "{\n  \"stages\": [\n";
+    size_t i = 0;
+    for (const auto& kv : fRecords) {
+      std::string Stage = kv.first, Detail;
+      size_t Slash = Stage.find('|');
+      if (Slash != std::string::npos) { Detail = Stage.substr(Slash + 1); Stage = Stage.substr(0, Slash); }
+      const StageRecord& R = kv.second;
+      Csv << Stage << ',' << Detail << ',' << R.Calls << ',' << Form("%.6f", R.Seconds) << ','
+          << R.BytesRead << ',' << R.ReadCalls << ',' << R.UnzipBytes << ',' << Form("%.6f", R.UnzipSeconds) << '\n';
+      Json << Form("    {\"stage\": \"%s\", \"detail\": \"%s\", \"calls\": %lld, \"seconds\": %.6f, "
+                   "\"bytes_read\": %lld, \"read_calls\": %lld, \"unzip_bytes\": %lld, \"unzip_seconds\": %.6f}%s\n",
+                   Stage.c_str(), Detail.c_str(), R.Calls, R.Seconds, R.BytesRead, R.ReadCalls,
+                   R.UnzipBytes, R.UnzipSeconds, (++i < fRecords.size()) ? "," : "");
+      std::cout << Form("[TIME] %-12s %-40s %6lld x %10.3f s %10.1f MB", Stage.c_str(), Detail.c_str(),
+                        R.Calls, R.Seconds, R.BytesRead / 1e6) << std::endl;
+    }
+    Json << "  ]\n}\n";
+    std::cout << "Instrumentation summary: " << Base << ".json, " << Base << ".csv" << std::endl;
+  }
+
+private:
+  std::map<std::string, StageRecord> fRecords; // key: "stage|detail"
+  mutable std::mutex fMutex;
+};
+
+inline InstrumentationRegistry& GetInstrumentation() {
+  static InstrumentationRegistry Registry;
+  return Registry;
+}
+
+// Helper: registry key of a stage and its detail
+inline std::string StageKey(const char* Stage, const char* Detail) {
+  std::string Key(Stage);
+  if (Detail && Detail[0]) { Key += '|'; Key += Detail; }
+  return Key;
+}
+
+// Wall time of a scope, added to the stage
+class ScopedStageTimer {
+public:
+  explicit ScopedStageTimer(const char* Stage, const char* Detail = "") : fOn(InstrumentationEnabled()) {
+    if (!fOn) return;
+    fKey = StageKey(Stage, Detail);
+    fStart = std::chrono::steady_clock::now();
+  }
+  ~ScopedStageTimer() {
+    if (!fOn) return;
+    GetInstrumentation().AddTime(fKey, std::chrono::duration<double>(std::chrono::steady_clock::now() - fStart).count());
+  }
+  ScopedStageTimer(const ScopedStageTimer&) = delete;
+  ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+  bool fOn;
+  std::string fKey;
+  std::chrono::steady_clock::time_point fStart;
+};
+
+// TTreePerfStats on a tree for the lifetime of the scope: bytes read, read calls and
+// decompression of that tree, added to stage "io". Declare it after the TFile owning the tree.
+class ScopedTreeIO {
+public:
+  ScopedTreeIO(TTree* Tree, const char* Detail) : fTree(InstrumentationEnabled() ? Tree : nullptr) {
+    if (!fTree) return;
+    fKey = StageKey("io", Detail);
+    fStart = std::chrono::steady_clock::now();
+    fPerf.reset(new TTreePerfStats("ioperf", fTree)); // attaches itself to the tree
+  }
+  ~ScopedTreeIO() {
+    if (!fTree) return;
+    fPerf->Finish();
+    GetInstrumentation().AddIO(fKey, std::chrono::duration<double>(std::chrono::steady_clock::now() - fStart).count(),
+                               fPerf->GetBytesRead(), fPerf->GetReadCalls(), fPerf->GetUnzipInputSize(),
+                               fPerf->GetUnzipTime());
+    fTree->SetPerfStats(nullptr);
+  }
+  ScopedTreeIO(const ScopedTreeIO&) = delete;
+  ScopedTreeIO& operator=(const ScopedTreeIO&) = delete;
+
+private:
+  TTree* fTree;
+  std::string fKey;
+  std::chrono::steady_clock::time_point fStart;
+  std::unique_ptr<TTreePerfStats> fPerf;
+};
+
+// Writes the summary when the enclosing function returns (any return path)
+class ScopedInstrumentationSummary {
+public:
+  explicit ScopedInstrumentationSummary(const std::string& Base) : fBase(Base) {}
+  ~ScopedInstrumentationSummary() { if (InstrumentationEnabled()) GetInstrumentation().Write(fBase); }
+private:
+  std::string fBase;
+};
+
+#endif // INSTRUMENTATION_H
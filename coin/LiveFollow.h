@@ -0,0 +1,64 @@
+// LiveFollow.h
+// Follow mode for replay files that hcana is still writing: the file is polled, the tree header
+// is refreshed from its latest AutoSave, and the caller processes only the entries appended since
+// the last poll (IncrementalRandomSubtraction for the data-vs-SIMC histograms, the QC fills of
+// hodo_calib_qc_batch). A file that has not been created yet, or has no tree yet, is retried.
+// The caller decides when the run is over (e.g. the file has not grown for a number of polls).
+#ifndef LIVE_FOLLOW_H
+#define LIVE_FOLLOW_H
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "TFile.h"
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TTree.h"
+#include "TString.h"
+#include "FileStamp.h"
+
+class GrowingTreeFollower {
+public:
+  explicit GrowingTreeFollower(const std::string& Path, const char* TreeName = "T") : fPath(Path), fTreeName(TreeName) {}
+  GrowingTreeFollower(const GrowingTreeFollower&) = delete;
+  GrowingTreeFollower& operator=(const GrowingTreeFollower&) = delete;
+
+  // Open the file (first time, or until it has the tree) or refresh the tree to the entries
+  // written so far; returns the number of entries (0 if there is no tree yet)
+  Long64_t Poll() {
+    if (!fTree) {
+      if (gSystem->AccessPathName(fPath.c_str())) return 0;
+      fFile.reset(TFile::Open(fPath.c_str(), "READ"));
+      fTree = (fFile && !fFile->IsZombie()) ? (TTree*)fFile->Get(fTreeName.c_str()) : nullptr;
+      if (!fTree) { fFile.reset(); return 0; }
+    }
+    else {
+      fTree->Refresh(); // re-reads the keys and the tree header of the latest AutoSave
+    }
+    return fTree->GetEntries();
+  }
+
+  // True once the tree was opened; Tree() then stays the same object for the whole follow
+  bool IsOpen() const { return fTree != nullptr; }
+  TTree* Tree() const { return fTree; }
+  const std::string& Path() const { return fPath; }
+
+  // Read entries [First, Last) through the tree's cache (its entry range is fixed at creation)
+  void SetReadRange(Long64_t First, Long64_t Last) { if (fTree) fTree->SetCacheEntryRange(First, Last); }
+
+  // Wait Seconds between polls (keeps ROOT's event loop alive)
+  static void Wait(int Seconds) {
+    for (int ms = 0; ms < Seconds * 1000; ms += 200) {
+      gSystem->ProcessEvents();
+      gSystem->Sleep(200);
+    }
+  }
+
+private:
+  std::string fPath, fTreeName;
+  std::unique_ptr<TFile> fFile;
+  TTree* fTree = nullptr; // owned by fFile
+};
+
+#endif // LIVE_FOLLOW_H
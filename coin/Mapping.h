@@ -22,7 +22,7 @@ inline std::string SimToDataMap(const std::string& simVar) {
         {"ssxptar",  "P.gtr.th"},
         {"ssyptar",  "P.gtr.ph"},
         // Kinematic Variables
-        {"z", "P.gtr.p/H.kin.primary.nu"},//z needs to be created from other branches
+        {"z", "rp_z"},//P.gtr.p/H.kin.primary.nu, precomputed with its nu > 0 flag (DerivedColumns.h)
         {"xbj", "H.kin.primary.x_bj"},
         {"Q2", "H.kin.primary.Q2"},
         {"W", "H.kin.primary.W"},
@@ -30,7 +30,7 @@ inline std::string SimToDataMap(const std::string& simVar) {
         {"nu", "H.kin.primary.nu"},
         {"thetapq", "P.kin.secondary.th_xq"},
         //{"phipq", "P.kin.secondary.ph_xq"}
-	{"phipq", "(P.kin.secondary.ph_xq < 0 ? P.kin.secondary.ph_xq + 2*TMath::Pi() : P.kin.secondary.ph_xq)"}//This ensures phipq of both simc and hcana will be mapped to range [0, 2pi].This line maps hcana variable to [0, 2pi]
+	{"phipq", "rp_phipq"}//(P.kin.secondary.ph_xq < 0 ? P.kin.secondary.ph_xq + 2*TMath::Pi() : P.kin.secondary.ph_xq), precomputed (DerivedColumns.h). This ensures phipq of both simc and hcana will be mapped to range [0, 2pi].This line maps hcana variable to [0, 2pi]
 
 
     }; //stdMap = Sim To Data Map
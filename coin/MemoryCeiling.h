@@ -0,0 +1,69 @@
+// MemoryCeiling.h
+// Resident-memory ceiling for long variable and run lists. The macro calls Check() after each
+// finished unit of work (a variable, a run average); above the ceiling the registered release
+// steps run in order (e.g. drop cached per-run histograms, project fewer runs at once) until the
+// process is back under it.
+//
+// Limit: SetLimitMB(), or RP_MAX_RSS_MB in the environment; 0 = no ceiling.
+#ifndef MEMORY_CEILING_H
+#define MEMORY_CEILING_H
+
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "TSystem.h"
+
+// Resident set size of this process in MB (0 if it cannot be read)
+inline double ResidentMemoryMB() {
+  ProcInfo_t Info;
+  if (gSystem->GetProcInfo(&Info) != 0) return 0.0;
+  return Info.fMemResident / 1024.0; // kB
+}
+
+class MemoryCeiling {
+public:
+  MemoryCeiling() {
+    const char* Env = std::getenv("RP_MAX_RSS_MB");
+    if (Env && Env[0]) fLimitMB = std::atof(Env);
+  }
+
+  void   SetLimitMB(double MB) { fLimitMB = MB; }
+  double LimitMB() const { return fLimitMB; }
+
+  // Release step, tried in registration order; returns false once it has nothing left to release.
+  // A step registered again under the same name replaces the old one.
+  void OnPressure(const std::string& Name, const std::function<bool()>& Release) {
+    for (auto& S : fSteps) if (S.Name == Name) { S.Release = Release; return; }
+    fSteps.push_back({Name, Release});
+  }
+
+  // True if the process is under the ceiling (after running as many release steps as needed)
+  bool Check(const std::string& Where) {
+    if (fLimitMB <= 0) return true;
+    double Rss = ResidentMemoryMB();
+    if (Rss > fPeakMB) fPeakMB = Rss;
+    for (auto& S : fSteps) {
+      if (Rss <= fLimitMB) return true;
+      if (!S.Release()) continue;
+      const double After = ResidentMemoryMB();
+      std::cerr << "[INFO] RSS " << Rss << " MB above the " << fLimitMB << " MB ceiling after " << Where
+                << ": " << S.Name << " (now " << After << " MB)\n";
+      Rss = After;
+    }
+    if (Rss <= fLimitMB) return true;
+    std::cerr << "[WARN] RSS " << Rss << " MB still above the " << fLimitMB << " MB ceiling after " << Where << "\n";
+    return false;
+  }
+
+  double PeakMB() const { return fPeakMB; }
+
+private:
+  struct Step { std::string Name; std::function<bool()> Release; };
+  double fLimitMB = 0.0;
+  double fPeakMB = 0.0;
+  std::vector<Step> fSteps;
+};
+
+#endif // MEMORY_CEILING_H
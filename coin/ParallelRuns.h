@@ -0,0 +1,91 @@
+// ParallelRuns.h
+// Run independent per-run jobs (one TFile each) on a small pool of std::threads, or
+// independent jobs that use non-thread-safe ROOT parts (graphics) in forked worker processes.
+#ifndef PARALLEL_RUNS_H
+#define PARALLEL_RUNS_H
+
+#include <atomic>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "TROOT.h"
+
+// Call Job(i) for i in [0, NJobs). With NThreads <= 1 this is a plain loop in index order.
+// Otherwise jobs are handed out to NThreads workers; callers write results into slot i and
+// merge them afterwards in index order, so the outcome does not depend on the thread count.
+// An exception thrown by a job is re-thrown here (the one of the lowest index first).
+inline void RunJobsInParallel(size_t NJobs, int NThreads, const std::function<void(size_t)>& Job) {
+  if (NThreads <= 1 || NJobs <= 1) {
+    for (size_t i = 0; i < NJobs; ++i) Job(i);
+    return;
+  }
+
+  // Per-thread gDirectory and locked ROOT globals; needed before opening files in threads
+  ROOT::EnableThreadSafety();
+
+  std::atomic<size_t> Next(0);
+  std::vector<std::exception_ptr> Errors(NJobs);
+  auto Worker = [&]() {
+    for (size_t i = Next++; i < NJobs; i = Next++) {
+      try { Job(i); }
+      catch (...) { Errors[i] = std::current_exception(); }
+    }
+  };
+
+  std::vector<std::thread> Pool;
+  const size_t NWorkers = std::min<size_t>(size_t(NThreads), NJobs);
+  for (size_t t = 0; t < NWorkers; ++t) Pool.emplace_back(Worker);
+  for (auto& th : Pool) th.join();
+
+  for (auto& e : Errors) if (e) std::rethrow_exception(e);
+}
+
+// Call Job(i) for i in [0, NJobs) in NProcs forked worker processes (worker w runs the jobs
+// i = w, w + NProcs, ...); with NProcs <= 1 this is a plain loop in index order. Jobs cannot
+// return anything to the caller: they write their own output files. Open files and canvases
+// in the job, not before, so no ROOT object is shared across the fork.
+// Returns the number of workers that failed (a job threw, or the process died).
+inline int RunJobsInProcesses(size_t NJobs, int NProcs, const std::function<void(size_t)>& Job) {
+  if (NProcs <= 1 || NJobs <= 1) {
+    int Failed = 0;
+    for (size_t i = 0; i < NJobs; ++i) {
+      try { Job(i); }
+      catch (const std::exception& e) { std::cerr << "[ERROR] Job " << i << ": " << e.what() << "\n"; Failed = 1; }
+    }
+    return Failed;
+  }
+
+  // Buffered output would otherwise be written once by every child
+  std::cout.flush(); std::cerr.flush(); std::fflush(nullptr);
+
+  const size_t NWorkers = std::min<size_t>(size_t(NProcs), NJobs);
+  std::vector<pid_t> Pids;
+  int Failed = 0;
+  for (size_t w = 0; w < NWorkers; ++w) {
+    pid_t Pid = fork();
+    if (Pid == 0) {
+      int Status = 0;
+      for (size_t i = w; i < NJobs; i += NWorkers) {
+        try { Job(i); }
+        catch (const std::exception& e) { std::cerr << "[ERROR] Job " << i << ": " << e.what() << "\n"; Status = 1; }
+      }
+      std::cout.flush(); std::cerr.flush(); std::fflush(nullptr);
+      _exit(Status); // no atexit handlers / ROOT cleanup of the parent's objects
+    }
+    if (Pid < 0) { std::cerr << "[ERROR] fork failed for worker " << w << "\n"; ++Failed; continue; }
+    Pids.push_back(Pid);
+  }
+  for (pid_t Pid : Pids) {
+    int Status = 0;
+    if (waitpid(Pid, &Status, 0) < 0 || !WIFEXITED(Status) || WEXITSTATUS(Status) != 0) ++Failed;
+  }
+  return Failed;
+}
+
+#endif // PARALLEL_RUNS_H
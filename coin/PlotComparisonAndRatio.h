@@ -9,12 +9,22 @@
 #include <TSystem.h>
 #include <TROOT.h>
 #include <iostream>
+#include <memory>
 #include <string>
 #include "Mapping.h" // To call BranchToPhysicsMap to give proper title
 
-// Plotting function
-// Use h1 and h2 as hSim and hDataSubDummy respectively
-void PlotComparisonAndRatio(TH1D* h1, TH1D* h2, std::string varName) {
+// Ratio histogram Sim / (Data - Dummy), detached from any directory
+inline std::unique_ptr<TH1D> MakeRatioHistogram(const TH1D* h1, const TH1D* h2, const char* name) {
+    std::unique_ptr<TH1D> hRatio((TH1D*) h1 -> Clone(name)); // clone to avoid modifying original
+    hRatio->SetDirectory(nullptr);
+    hRatio->Divide(h2); // Sim / (Data - Dummy)
+    return hRatio;
+}
+
+// Drawing function: comparison (upper pad) and ratio (lower pad), saved as ./PNGs/<varName>_comparison.png
+// (and .pdf in ./PDFs with savePdf). Use h1 and h2 as hSim and hDataSubDummy respectively; the canvas,
+// legend and line are deleted on return, the histograms stay with the caller.
+inline void DrawComparisonAndRatio(TH1D* h1, TH1D* h2, TH1D* hRatio, const std::string& varName, bool savePdf = false) {
 
     // Find the max values from both histograms
     double max1 = h1 -> GetMaximum();
@@ -24,7 +34,7 @@ void PlotComparisonAndRatio(TH1D* h1, TH1D* h2, std::string varName) {
     double ymax = std::max(max1, max2) * 1.1;
 
     //Draw the canvas
-    TCanvas* c1 = new TCanvas(Form("c_%s", varName.c_str()), Form("Data Vs Simulation: %s", varName.c_str()), 900, 700);
+    std::unique_ptr<TCanvas> c1(new TCanvas(Form("c_%s", varName.c_str()), Form("Data Vs Simulation: %s", varName.c_str()), 900, 700));
     c1->Divide(1, 2);
 
     // Upper pad: comparison plot
@@ -57,7 +67,7 @@ void PlotComparisonAndRatio(TH1D* h1, TH1D* h2, std::string varName) {
     h2->Draw("HIST SAME");
 
     // Legend
-    auto leg = new TLegend();
+    std::unique_ptr<TLegend> leg(new TLegend());
     // Dynamic positioning of legend box
     int maxBin = h1->GetMaximumBin();
     double maxX = h1->GetXaxis()->GetBinCenter(maxBin);
@@ -90,10 +100,7 @@ void PlotComparisonAndRatio(TH1D* h1, TH1D* h2, std::string varName) {
     pad_d->Draw();
     pad_d->cd();
 
-    // Make ratio histogram
-    TH1D* hRatio = (TH1D*) h1 -> Clone("hRatio"); // clone to avoid modifying original
-    hRatio->Divide(h2); // Sim / (Data - Dummy)
-
+    // Ratio histogram
     hRatio->SetLineColor(kBlack);
     hRatio->SetStats(0);
     hRatio->SetTitle("");
@@ -125,21 +132,32 @@ void PlotComparisonAndRatio(TH1D* h1, TH1D* h2, std::string varName) {
     gPad->RedrawAxis();
 
     // Draw a dashed line at y=1
-    TLine* line = new TLine(hRatio->GetXaxis()->GetXmin(), 1.0, hRatio->GetXaxis()->GetXmax(), 1.0);
+    std::unique_ptr<TLine> line(new TLine(hRatio->GetXaxis()->GetXmin(), 1.0, hRatio->GetXaxis()->GetXmax(), 1.0));
     line->SetLineStyle(2);
     line->Draw();
 
-    //c1->SaveAs(Form("./PDFs/%s_comparison.pdf", varName.c_str()));
+    if (savePdf) c1->SaveAs(Form("./PDFs/%s_comparison.pdf", varName.c_str()));
     c1->SaveAs(Form("./PNGs/%s_comparison.png", varName.c_str()));
     // Show the plots interactively
     /*c1->Update();
     gSystem->ProcessEvents();
     std::cout << "Close the canvas to continue...\n";
-    while (gROOT->GetListOfCanvases()->FindObject(c1)) {
+    while (gROOT->GetListOfCanvases()->FindObject(c1.get())) {
         gSystem->ProcessEvents();
         gSystem->Sleep(100);
     }*/
 
+    // Primitives go before the canvas that lists them
+    line.reset();
+    leg.reset();
+    c1.reset();
+}
+
+// Plotting function
+// Use h1 and h2 as hSim and hDataSubDummy respectively
+inline void PlotComparisonAndRatio(TH1D* h1, TH1D* h2, std::string varName) {
+    std::unique_ptr<TH1D> hRatio = MakeRatioHistogram(h1, h2, Form("hRatio_%s", varName.c_str()));
+    DrawComparisonAndRatio(h1, h2, hRatio.get(), varName);
 }
 
 #endif // PLOT_COMPARISON_AND_RATIO_H
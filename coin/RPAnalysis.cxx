@@ -0,0 +1,7 @@
+// RPAnalysis.cxx
+// Translation unit of libRPAnalysis.so (Makefile): the data vs simulation analysis compiled with
+// optimization instead of interpreted by Cling. The macro stays the single source, so
+// root -l DataVsSimPlot_MultiDataMultiDummy.C and the library run the same code.
+//
+// Exports RunDataVsSimPlot(const DataVsSimSettings&) (DataVsSimConfig.h) and the macro entry point.
+#include "DataVsSimPlot_MultiDataMultiDummy.C"
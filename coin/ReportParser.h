@@ -1,48 +1,93 @@
 #ifndef REPORT_PARSER_H
 #define REPORT_PARSER_H
 
+// ReportParser.h (shared: single-arm/ includes ../coin/ReportParser.h)
+// ParseReportFile() reads charge, prescale factors and tracking efficiency from a replay .report
+// file; ReportIndex keeps those values for many reports in a CSV index, so a report is only
+// parsed again when its mtime or size changes.
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <stdexcept>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cctype>
+#include <cstdlib>
+#include "TSystem.h"
+#include "TString.h"
+#include "FileStamp.h"
 
 // Create a Structure to hold the values
 struct ReportValues {
     double charge_mC = 0.0;
     int ps_factor = 0;
     double hms_eff = 0.0;
+    std::map<int, int> ps_factors; // every PsN_factor of the report, by N
 };
 
-// Define the function
-inline ReportValues ParseReportFile(const std::string& filepath) {
-    std::ifstream file(filepath);
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open report file: " + filepath);
+// Where the values are in one kind of report
+struct ReportFormat {
+    std::string name;          // tag of the index file
+    std::string charge_label;  // line holding the charge
+    int charge_words;          // words before the charge value on that line
+    double charge_divisor;     // charge in the report / charge_divisor = charge in mC
+    int ps_index;              // ps_factor is PsN_factor with N = ps_index
+    std::string eff_label = "E SING FID TRACK EFFIC";
+};
+
+// COIN reports (coin/): HMS charge already in mC, Ps6 trigger
+inline ReportFormat CoinReportFormat() { return {"coin", "HMS BCM4C Beam Cut Charge:", 5, 1.0, 6}; }
+// HMS reports (single-arm/): charge in uC, Ps4 trigger
+inline ReportFormat HmsReportFormat()  { return {"hms", "BCM4C Beam Cut Charge", 4, 1000.0, 4}; }
+
+// Format of a report from its file name (replay_hms_* or HMS/ directory: HMS, otherwise COIN)
+inline ReportFormat ReportFormatForPath(const std::string& filepath) {
+    if (filepath.find("replay_hms_") != std::string::npos || filepath.find("/HMS/") != std::string::npos) return HmsReportFormat();
+    return CoinReportFormat();
+}
+
+// Helper: N of a "PsN_factor" in the line, -1 if there is none
+inline int PsFactorIndex(const std::string& line) {
+    for (size_t pos = line.find("Ps"); pos != std::string::npos; pos = line.find("Ps", pos + 2)) {
+        size_t end = pos + 2;
+        while (end < line.size() && isdigit((unsigned char)line[end])) ++end;
+        if (end > pos + 2 && line.compare(end, 7, "_factor") == 0) return std::atoi(line.c_str() + pos + 2);
     }
+    return -1;
+}
 
-    // Declare values and line to hold values and line from file
+// Parse the text of a report (the whole file in one string)
+inline ReportValues ParseReportText(const std::string& text, const ReportFormat& format) {
     ReportValues values;
-    std::string line;
-
-    // Parse
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.find('\n', begin);
+        if (end == std::string::npos) end = text.size();
+        const std::string line = text.substr(begin, end - begin);
+        begin = end + 1;
 
-        if (line.find("HMS BCM4C Beam Cut Charge:") != std::string::npos) {
+        int ps = -1;
+        if (line.find(format.charge_label) != std::string::npos) {
+            std::istringstream iss(line);
             std::string label, unit;
-            double charge;
-            iss >> label >> label >> label >> label >> label >> charge >> unit;
-            //values.charge_mC = charge / 1000.0;
-            values.charge_mC = charge;
+            double charge = 0.0;
+            for (int i = 0; i < format.charge_words; ++i) iss >> label;
+            iss >> charge >> unit;
+            values.charge_mC = charge / format.charge_divisor;
         }
-        else if (line.find("Ps6_factor") != std::string::npos) {
+        else if ((ps = PsFactorIndex(line)) >= 0) {
+            std::istringstream iss(line);
             std::string key, eq;
-            int factor;
+            int factor = 0;
             iss >> key >> eq >> factor;
-            values.ps_factor = factor;
+            values.ps_factors[ps] = factor;
+            if (ps == format.ps_index) values.ps_factor = factor;
         }
-	else if (line.find("E SING FID TRACK EFFIC") != std::string::npos) {
+	else if (line.find(format.eff_label) != std::string::npos) {
 	    size_t colon_pos = line.find(':');
 	    if (colon_pos != std::string::npos) {
 	        std::istringstream val_stream(line.substr(colon_pos + 1));
@@ -52,9 +97,145 @@ inline ReportValues ParseReportFile(const std::string& filepath) {
 	    }
 	}
     }
+    return values;
+}
 
+// Define the function
+inline ReportValues ParseReportFile(const std::string& filepath, const ReportFormat& format) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open report file: " + filepath);
+    }
+
+    // Read the whole file at once and parse it in memory
+    std::ostringstream text;
+    text << file.rdbuf();
     file.close();
-    return values;
+    return ParseReportText(text.str(), format);
+}
+inline ReportValues ParseReportFile(const std::string& filepath) {
+    return ParseReportFile(filepath, ReportFormatForPath(filepath));
+}
+
+
+// Values of many reports, stored in a CSV file (one line per report, numbers with %.17g) and
+// refreshed per report when its mtime or size changes. Safe to use from parallel run jobs.
+class ReportIndex {
+public:
+    ReportIndex(const ReportFormat& format, const std::string& dir = "./REPORT_INDEX")
+        : fFormat(format), fDir(dir), fPath(dir + "/report_index_" + format.name + ".csv") { Load(); }
+
+    // Values of one report; parsed (and the index file rewritten) only if it is not indexed yet
+    // or changed since. Throws like ParseReportFile if the report cannot be read.
+    ReportValues Get(const std::string& filepath) {
+        bool changed = false;
+        ReportValues v = Lookup(filepath, changed);
+        if (changed) { std::lock_guard<std::mutex> lock(fMutex); Save(); }
+        return v;
+    }
+
+    // Index every *.report file of a directory (new or changed ones are parsed), then save once
+    void Update(const std::string& dir) {
+        void* d = gSystem->OpenDirectory(dir.c_str());
+        if (!d) { std::cerr << "[WARN] ReportIndex: cannot open directory " << dir << "\n"; return; }
+        bool changed = false;
+        while (const char* name = gSystem->GetDirEntry(d)) {
+            std::string file(name);
+            if (file.size() > 7 && file.compare(file.size() - 7, 7, ".report") == 0) {
+                try { Lookup(dir + "/" + file, changed); }
+                catch (const std::exception& ex) { std::cerr << "[WARN] ReportIndex: " << ex.what() << "\n"; }
+            }
+        }
+        gSystem->FreeDirectory(d);
+        if (changed) { std::lock_guard<std::mutex> lock(fMutex); Save(); }
+    }
+
+private:
+    struct Entry { Long_t mtime = 0; Long64_t size = 0; ReportValues values; };
+
+    ReportValues Lookup(const std::string& filepath, bool& changed) {
+        Long_t mtime = 0; Long64_t size = 0;
+        if (!GetFileStamp(filepath, mtime, size)) {
+            throw std::runtime_error("Cannot open report file: " + filepath);
+        }
+        {
+            std::lock_guard<std::mutex> lock(fMutex);
+            auto it = fEntries.find(filepath);
+            if (it != fEntries.end() && it->second.mtime == mtime && it->second.size == size) return it->second.values;
+        }
+        Entry e;
+        e.mtime = mtime;
+        e.size = size;
+        e.values = ParseReportFile(filepath, fFormat);
+        std::lock_guard<std::mutex> lock(fMutex);
+        fEntries[filepath] = e;
+        changed = true;
+        return e.values;
+    }
+
+    void Load() { Read(fEntries); }
+
+    // Add the entries of the index file that are not in entries (those in entries are kept)
+    void Read(std::map<std::string, Entry>& entries) const {
+        std::ifstream in(fPath);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            // path,mtime,size,charge_mC,ps_factor,hms_eff,N:factor;N:factor;...
+            std::vector<std::string> f;
+            std::istringstream iss(line);
+            for (std::string s; std::getline(iss, s, ',');) f.push_back(s);
+            if (f.size() < 6) continue;
+            Entry e;
+            e.mtime = std::atol(f[1].c_str());
+            e.size = std::atoll(f[2].c_str());
+            e.values.charge_mC = std::strtod(f[3].c_str(), nullptr);
+            e.values.ps_factor = std::atoi(f[4].c_str());
+            e.values.hms_eff = std::strtod(f[5].c_str(), nullptr);
+            if (f.size() > 6) {
+                std::istringstream ps(f[6]);
+                for (std::string kv; std::getline(ps, kv, ';');) {
+                    size_t colon = kv.find(':');
+                    if (colon != std::string::npos) e.values.ps_factors[std::atoi(kv.c_str())] = std::atoi(kv.c_str() + colon + 1);
+                }
+            }
+            entries.emplace(f[0], e);
+        }
+    }
+
+    // Rewrite the index file with this index's entries and those other processes (shard workers)
+    // saved since it was loaded, so no process drops the reports another one parsed
+    void Save() {
+        Read(fEntries);
+        gSystem->mkdir(fDir.c_str(), true);
+        std::string tmp = fPath + CacheTmpSuffix();
+        std::ofstream out(tmp);
+        out << "# path,mtime,size,charge_mC,ps_factor,hms_eff,N:PsN_factor;... (" << fFormat.name << " reports)\n";
+        for (const auto& kv : fEntries) {
+            const ReportValues& v = kv.second.values;
+            out << kv.first << ',' << kv.second.mtime << ',' << kv.second.size
+                << Form(",%.17g,%d,%.17g,", v.charge_mC, v.ps_factor, v.hms_eff);
+            for (const auto& ps : v.ps_factors) out << ps.first << ':' << ps.second << ';';
+            out << '\n';
+        }
+        out.close();
+        gSystem->Rename(tmp.c_str(), fPath.c_str());
+    }
+
+    ReportFormat fFormat;
+    std::string fDir, fPath;
+    std::map<std::string, Entry> fEntries;
+    std::mutex fMutex; // runs may be processed in parallel (ParallelRuns.h)
+};
+
+// Shared index of one report format for the macros
+inline ReportIndex& GetReportIndex(const ReportFormat& format) {
+    static std::mutex m;
+    static std::map<std::string, std::unique_ptr<ReportIndex>> indexes;
+    std::lock_guard<std::mutex> lock(m);
+    auto& idx = indexes[format.name];
+    if (!idx) idx.reset(new ReportIndex(format));
+    return *idx;
 }
 
 #endif // REPORT_PARSER_H
@@ -0,0 +1,88 @@
+// RunHistogramStore.h
+// In-memory memo of per-run projections, so a run listed twice (or in several run lists) is
+// only projected, and its report only parsed, once per macro invocation.
+//
+// Key   : run number, variable expressions and binning, hash of the cuts, hash of the CT config.
+// Value : the run's histograms, its ReportValues and the charge it adds to the total.
+//         Histograms are shared read-only (Clone/Add them).
+// Runs may be projected in parallel (ParallelRuns.h): the first caller of a key builds the
+// entry, concurrent callers of the same key wait for it.
+#ifndef RUN_HISTOGRAM_STORE_H
+#define RUN_HISTOGRAM_STORE_H
+
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "TH1D.h"
+#include "TString.h"
+#include "ReportParser.h"
+#include "CoincidencePeakCache.h"
+
+struct RunHistograms {
+  std::vector<std::shared_ptr<const TH1D>> Hists; // empty if the run could not be projected
+  ReportValues Report;
+  double ChargeAdded_mC = 0.0; // charge the run adds to the average's total
+};
+
+// Helper: key part of one variable (expression and binning, edges with %.17g)
+inline TString HistogramSpecKey(const std::string& Expr, int NBins, double XMin, double XMax) {
+  return TString::Format("%s[%d,%.17g,%.17g];", Expr.c_str(), NBins, XMin, XMax);
+}
+
+// Helper: full key of one run (Vars: HistogramSpecKey of each variable, in order)
+inline std::string RunHistogramKey(int Run, const TString& Vars, const TString& Cuts,
+                                   const CoincidenceConfig& Config) {
+  return Form("%d|%u|%u|%s", Run, Cuts.Hash(), CoincidenceConfigHash(Config), Vars.Data());
+}
+
+class RunHistogramStore {
+public:
+  typedef std::shared_ptr<const RunHistograms> EntryPtr;
+  typedef std::function<RunHistograms()> Builder;
+
+  // Entry of Key; built with Build on the first request. An exception thrown by Build is
+  // re-thrown to every caller of that key.
+  EntryPtr Get(const std::string& Key, const Builder& Build) {
+    std::promise<EntryPtr> Promise;
+    std::shared_future<EntryPtr> Future;
+    bool Mine = false;
+    {
+      std::lock_guard<std::mutex> Lock(fMutex);
+      auto it = fEntries.find(Key);
+      if (it == fEntries.end()) {
+        Future = Promise.get_future().share();
+        fEntries[Key] = Future;
+        Mine = true;
+      } else {
+        Future = it->second;
+      }
+    }
+    if (Mine) {
+      try { Promise.set_value(std::make_shared<const RunHistograms>(Build())); }
+      catch (...) { Promise.set_exception(std::current_exception()); }
+    }
+    return Future.get();
+  }
+
+  // True if Key has an entry (built, or being built by another caller)
+  bool Contains(const std::string& Key) const { std::lock_guard<std::mutex> Lock(fMutex); return fEntries.count(Key) > 0; }
+
+  size_t Size() const { std::lock_guard<std::mutex> Lock(fMutex); return fEntries.size(); }
+  void Clear() { std::lock_guard<std::mutex> Lock(fMutex); fEntries.clear(); }
+
+private:
+  std::map<std::string, std::shared_future<EntryPtr>> fEntries;
+  mutable std::mutex fMutex;
+};
+
+// Shared store instance for the macros
+inline RunHistogramStore& GetRunHistogramStore() {
+  static RunHistogramStore Store;
+  return Store;
+}
+
+#endif // RUN_HISTOGRAM_STORE_H
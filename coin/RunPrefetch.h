@@ -0,0 +1,59 @@
+// RunPrefetch.h
+// Pipelined per-run input: when run i is taken for projection, the next Depth runs are fetched
+// (file open, tree lookup, report, first baskets; whatever Fetch does) on background threads,
+// so open and first-read latency on network storage overlaps with the projection of run i.
+//
+// Memory: only runs up to Depth ahead of the highest run taken are fetched early, so at most
+// about Depth fetched runs wait at any time. Depth <= 0 fetches every run when it is taken, on
+// the caller's thread (no background threads).
+// Take may be called from several threads (RunJobsInParallel); results are handed over whole,
+// so each fetched object is used by one thread at a time.
+#ifndef RUN_PREFETCH_H
+#define RUN_PREFETCH_H
+
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include "TROOT.h"
+
+template <class T>
+class RunPrefetcher {
+public:
+  typedef std::function<T(size_t)> Fetch;
+
+  RunPrefetcher(size_t NItems, int Depth, const Fetch& F)
+    : fNItems(NItems), fDepth(std::max(0, Depth)), fFetch(F) {
+    // Per-thread gDirectory and locked ROOT globals; needed before opening files in threads
+    if (fDepth > 0 && fNItems > 1) ROOT::EnableThreadSafety();
+  }
+  ~RunPrefetcher() { for (auto& P : fPending) if (P.second.valid()) P.second.wait(); }
+  RunPrefetcher(const RunPrefetcher&) = delete;
+  RunPrefetcher& operator=(const RunPrefetcher&) = delete;
+
+  // Item i (fetched now if its prefetch was not started); starts the fetches up to i + Depth.
+  // An exception thrown by Fetch(i) is re-thrown here.
+  T Take(size_t i) {
+    std::future<T> Ready;
+    {
+      std::lock_guard<std::mutex> Lock(fMutex);
+      auto it = fPending.find(i);
+      if (it != fPending.end()) { Ready = std::move(it->second); fPending.erase(it); }
+      fNext = std::max(fNext, i + 1);
+      for (; fNext < fNItems && fNext <= i + size_t(fDepth); ++fNext)
+        fPending[fNext] = std::async(std::launch::async, fFetch, fNext);
+    }
+    return Ready.valid() ? Ready.get() : fFetch(i);
+  }
+
+private:
+  size_t fNItems;
+  int fDepth;
+  Fetch fFetch;
+  size_t fNext = 0; // first item whose fetch has not been started
+  std::map<size_t, std::future<T>> fPending;
+  std::mutex fMutex;
+};
+
+#endif // RUN_PREFETCH_H
@@ -0,0 +1,195 @@
+// RunShards.h
+// Sharded execution of the data/dummy projections. The runs of all run lists are split into N
+// shards; each shard projects its runs (in any process, on any machine) and writes every run's
+// histograms and charge to a shard file. The merge step reads the shard files in place of the
+// trees, so the charge-normalized averages are built by the same code, in the same run order,
+// as in one unsharded invocation, and come out bit-identical.
+//
+// Shards keep per-run histograms, not partial sums: adding up shard sums would group the
+// floating-point additions differently from the run-order merge.
+//
+// File  : ./SHARDS/shard_<k>_of_<N>.root (temporary file + rename)
+//   FormatVersion     TNamed, kRunShardFormatVersion; the merge refuses other versions
+//   ShardKey          TNamed, cuts, CT config and projection mode the runs were projected with
+//   Runs              TNamed, runs of the shard, comma separated
+//   run_<run>/Specs   TNamed, HistogramSpecKey of each histogram, in order
+//   run_<run>/Charge  TNamed, charge the run adds to the total (%.17g)
+//   run_<run>/h<i>    TH1D, i-th histogram of Specs
+#ifndef RUN_SHARDS_H
+#define RUN_SHARDS_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TH1D.h"
+#include "TNamed.h"
+#include "TObjArray.h"
+#include "TObjString.h"
+#include "TSystem.h"
+#include "TString.h"
+#include "CoincidencePeakCache.h"
+
+const int kRunShardFormatVersion = 1;
+
+inline const char* DefaultRunShardDir() { return "./SHARDS"; }
+
+inline std::string RunShardPath(const std::string& Dir, int K, int N) {
+  return Dir + Form("/shard_%d_of_%d.root", K, N);
+}
+
+// Helper: key of the projection settings a shard was written with (merge checks it)
+inline std::string RunShardKey(const TString& Cuts, const CoincidenceConfig& Config, bool SinglePass) {
+  return Form("%u|%u|%d", Cuts.Hash(), CoincidenceConfigHash(Config), SinglePass ? 1 : 0);
+}
+
+// Runs of shard K of N: each distinct run once, in order of first appearance, dealt round-robin
+inline std::vector<int> ShardRuns(const std::vector<int>& Runs, int K, int N) {
+  std::vector<int> Unique, Mine;
+  for (int R : Runs) if (std::find(Unique.begin(), Unique.end(), R) == Unique.end()) Unique.push_back(R);
+  for (size_t i = 0; i < Unique.size(); ++i) if (N > 0 && int(i % N) == K) Mine.push_back(Unique[i]);
+  return Mine;
+}
+
+class RunShardWriter {
+public:
+  RunShardWriter(const std::string& Path, const std::string& ShardKey)
+    : fPath(Path), fTmp(Path + Form(".tmp.%d", gSystem->GetPid())), fKey(ShardKey) {
+    gSystem->mkdir(gSystem->GetDirName(Path.c_str()).Data(), true);
+    fFile.reset(TFile::Open(fTmp.c_str(), "RECREATE"));
+    if (!fFile || fFile->IsZombie()) { std::cerr << "[ERROR] Cannot write " << fTmp << "\n"; fFile.reset(); }
+  }
+  ~RunShardWriter() { if (fFile) { fFile->Close(); gSystem->Unlink(fTmp.c_str()); } } // not Closed: no shard
+  RunShardWriter(const RunShardWriter&) = delete;
+  RunShardWriter& operator=(const RunShardWriter&) = delete;
+
+  bool IsOpen() const { return fFile != nullptr; }
+
+  // Write one run: its histograms (Specs[i] describes Hists[i]; empty if the run could not be
+  // projected) and the charge it adds to the total
+  bool Add(int Run, const std::vector<std::string>& Specs, const std::vector<std::shared_ptr<const TH1D>>& Hists,
+           double Charge) {
+    if (!fFile || Specs.size() != Hists.size()) return false;
+    TDirectory* D = fFile->mkdir(Form("run_%d", Run));
+    if (!D) { std::cerr << "[ERROR] Run " << Run << " written twice to " << fPath << "\n"; return false; }
+    TString SpecList;
+    for (size_t i = 0; i < Hists.size(); ++i) {
+      if (!Hists[i]) return false;
+      D->WriteTObject(Hists[i].get(), Form("h%zu", i));
+      SpecList += Specs[i].c_str();
+      SpecList += "\n";
+    }
+    TNamed S("Specs", SpecList.Data());
+    TNamed Q("Charge", Form("%.17g", Charge));
+    D->WriteTObject(&S);
+    D->WriteTObject(&Q);
+    fRuns += Form("%s%d", fRuns.Length() ? "," : "", Run);
+    return true;
+  }
+
+  // Write the header objects and move the file into place
+  bool Close() {
+    if (!fFile) return false;
+    TNamed Version("FormatVersion", Form("%d", kRunShardFormatVersion));
+    TNamed Key("ShardKey", fKey.c_str());
+    TNamed Runs("Runs", fRuns.Data());
+    fFile->WriteTObject(&Version);
+    fFile->WriteTObject(&Key);
+    fFile->WriteTObject(&Runs);
+    fFile->Close();
+    fFile.reset();
+    return gSystem->Rename(fTmp.c_str(), fPath.c_str()) == 0;
+  }
+
+private:
+  std::string fPath, fTmp, fKey;
+  TString fRuns;
+  std::unique_ptr<TFile> fFile;
+};
+
+// The runs of all shard files of one sharded invocation, held in memory (read-only once loaded,
+// so projections on several threads can look them up)
+class RunShardSet {
+public:
+  // Read shards 0..N-1 of Dir; false if one is missing, of another format or written with
+  // other settings than ShardKey
+  bool Load(const std::string& Dir, int N, const std::string& ShardKey) {
+    fRuns.clear();
+    bool Ok = N > 0;
+    for (int K = 0; K < N; ++K) {
+      const std::string Path = RunShardPath(Dir, K, N);
+      std::unique_ptr<TFile> F(TFile::Open(Path.c_str(), "READ"));
+      if (!F || F->IsZombie()) { std::cerr << "[ERROR] Cannot read shard " << Path << "\n"; Ok = false; continue; }
+      TNamed* V = (TNamed*)F->Get("FormatVersion");
+      TNamed* Key = (TNamed*)F->Get("ShardKey");
+      TNamed* Runs = (TNamed*)F->Get("Runs");
+      if (!V || TString(V->GetTitle()).Atoi() != kRunShardFormatVersion || !Key || !Runs) {
+        std::cerr << "[ERROR] " << Path << " is not a shard file of format version " << kRunShardFormatVersion << "\n";
+        Ok = false; continue;
+      }
+      if (ShardKey != Key->GetTitle()) {
+        std::cerr << "[ERROR] " << Path << " was written with other cuts, CT config or projection mode\n";
+        Ok = false; continue;
+      }
+      std::unique_ptr<TObjArray> Tok(TString(Runs->GetTitle()).Tokenize(","));
+      for (int i = 0; i < Tok->GetEntries(); ++i) {
+        const int Run = ((TObjString*)Tok->At(i))->GetString().Atoi();
+        if (!ReadRun(*F, Run, fRuns[Run])) { std::cerr << "[ERROR] Run " << Run << " is incomplete in " << Path << "\n"; Ok = false; }
+      }
+    }
+    return Ok;
+  }
+
+  // True if Run is in a shard with all of Specs (or was written without histograms)
+  bool Covers(int Run, const std::vector<std::string>& Specs) const {
+    auto it = fRuns.find(Run);
+    if (it == fRuns.end()) return false;
+    if (it->second.Hists.empty()) return true;
+    for (const auto& S : Specs) if (!it->second.Hists.count(S)) return false;
+    return true;
+  }
+
+  // Histograms of Run for Specs (empty if the run has none), adding its charge to Qsum_mC
+  std::vector<std::shared_ptr<const TH1D>> Get(int Run, const std::vector<std::string>& Specs, double& Qsum_mC) const {
+    std::vector<std::shared_ptr<const TH1D>> Out;
+    auto it = fRuns.find(Run);
+    if (it == fRuns.end()) return Out;
+    Qsum_mC += it->second.Charge;
+    if (it->second.Hists.empty()) return Out;
+    for (const auto& S : Specs) {
+      auto h = it->second.Hists.find(S);
+      Out.push_back(h != it->second.Hists.end() ? h->second : nullptr);
+    }
+    return Out;
+  }
+
+private:
+  struct RunEntry {
+    double Charge = 0.0;
+    std::map<std::string, std::shared_ptr<const TH1D>> Hists; // by HistogramSpecKey
+  };
+
+  static bool ReadRun(TFile& F, int Run, RunEntry& E) {
+    TNamed* S = (TNamed*)F.Get(Form("run_%d/Specs", Run));
+    TNamed* Q = (TNamed*)F.Get(Form("run_%d/Charge", Run));
+    if (!S || !Q) return false;
+    E.Charge = std::strtod(Q->GetTitle(), nullptr); // exact: written with %.17g
+    std::unique_ptr<TObjArray> Tok(TString(S->GetTitle()).Tokenize("\n"));
+    for (int i = 0; i < Tok->GetEntries(); ++i) {
+      TH1D* h = (TH1D*)F.Get(Form("run_%d/h%d", Run, i));
+      if (!h) return false;
+      h->SetDirectory(nullptr);
+      E.Hists[((TObjString*)Tok->At(i))->GetString().Data()] = std::shared_ptr<const TH1D>(h);
+    }
+    return true;
+  }
+
+  std::map<int, RunEntry> fRuns;
+};
+
+#endif // RUN_SHARDS_H
@@ -0,0 +1,139 @@
+// SkimCache.h
+// Per-run skims: slim copies of the replay tree holding only the events that pass the base cuts
+// and the wide CT gate, and only the analysis columns. Projections read the skim instead of the
+// full replay file whenever it is fresh, and get the same histograms (the skim keeps every event
+// the cuts can select, in the original order, with the original branch contents).
+//
+// Fresh : the skim was made from the replay file with its current mtime and size, with the same
+//         columns, CT branch and wide gate, and the requested cuts are the skim cuts or the skim
+//         cuts AND-ed with more ("(skimCuts)&&(...)", as TCut/TypedCut/CombineCutsAND write it).
+// File  : ./SKIMS/coin_skim_<run>.root, tree "T" plus the TNamed "SkimCuts" and "SkimKey".
+#ifndef SKIM_CACHE_H
+#define SKIM_CACHE_H
+
+#include <memory>
+#include <string>
+#include <set>
+#include <vector>
+#include <iostream>
+#include "TFile.h"
+#include "TTree.h"
+#include "TNamed.h"
+#include "TSystem.h"
+#include "TString.h"
+#include "FileStamp.h"
+#include "BranchPruning.h"
+#include "CoincidenceRandomSubtraction.h"
+
+struct SkimConfig {
+  std::string Dir = "./SKIMS";
+  // Branches copied to the skim (wildcards as in SetBranchStatus); the CT branch and the
+  // branches of the skim cuts are always added
+  std::vector<TString> Columns = {"H.gtr.*", "P.gtr.*", "H.kin.primary.*", "P.kin.secondary.*"};
+};
+
+inline std::string SkimPath(int Run, const SkimConfig& Skim) {
+  return Form("%s/coin_skim_%d.root", Skim.Dir.c_str(), Run);
+}
+
+// Helper: true if selecting Cuts on the skim gives the same events as on the replay file
+inline bool SkimCovers(const TString& SkimCuts, const TString& Cuts) {
+  if (SkimCuts.Length() == 0) return true;
+  return Cuts == SkimCuts || Cuts.BeginsWith("(" + SkimCuts + ")&&");
+}
+
+// Helper: everything a skim depends on besides its cuts; empty if the source cannot be stat'ed
+inline TString SkimKey(const std::string& SrcPath, const TString& SkimCuts,
+                       const CoincidenceConfig& Config, const SkimConfig& Skim) {
+  Long_t Mtime = 0; Long64_t Size = 0;
+  if (!GetFileStamp(SrcPath, Mtime, Size)) return "";
+  TString Cols;
+  for (const auto& C : Skim.Columns) Cols += C + ",";
+  TString WideGate = BuildRangeCut(Config.CtBranchName.Data(), Config.WideWindowMinNs, Config.WideWindowMaxNs);
+  return TString::Format("%ld %lld %u %u %u", Mtime, Size, SkimCuts.Hash(), WideGate.Hash(), Cols.Hash());
+}
+
+// Helper: skim cuts and key stored in a skim file (false if they are missing)
+inline bool ReadSkimInfo(TFile* F, TString& SkimCuts, TString& Key) {
+  TNamed* C = F ? dynamic_cast<TNamed*>(F->Get("SkimCuts")) : nullptr;
+  TNamed* K = F ? dynamic_cast<TNamed*>(F->Get("SkimKey"))  : nullptr;
+  if (!C || !K) return false;
+  SkimCuts = C->GetTitle();
+  Key      = K->GetTitle();
+  return true;
+}
+
+// Write the skim of one run unless a fresh one exists. Returns false if the replay file is
+// unusable or the skim could not be written.
+inline bool MakeRunSkim(int Run, const std::string& SrcPath, const TString& BaseCuts,
+                        const CoincidenceConfig& Config, const SkimConfig& Skim = SkimConfig())
+{
+  const std::string Path = SkimPath(Run, Skim);
+  const TString Key = SkimKey(SrcPath, BaseCuts, Config, Skim);
+  if (Key.Length() == 0) { std::cerr << "[WARN] Skim: cannot stat " << SrcPath << "\n"; return false; }
+
+  if (!gSystem->AccessPathName(Path.c_str())) {
+    std::unique_ptr<TFile> Old(TFile::Open(Path.c_str(), "READ"));
+    TString OldCuts, OldKey;
+    if (Old && !Old->IsZombie() && ReadSkimInfo(Old.get(), OldCuts, OldKey) &&
+        OldCuts == BaseCuts && OldKey == Key) return true;
+  }
+
+  std::unique_ptr<TFile> Src(TFile::Open(SrcPath.c_str(), "READ"));
+  if (!Src || Src->IsZombie()) { std::cerr << "[WARN] Skim: could not open " << SrcPath << "\n"; return false; }
+  TTree* T = (TTree*)Src->Get("T");
+  if (!T) { std::cerr << "[WARN] Skim: tree 'T' missing in " << SrcPath << "\n"; return false; }
+
+  // Columns: the configured ones, the CT branch and whatever the cuts read
+  TString WideGate = BuildRangeCut(Config.CtBranchName.Data(), Config.WideWindowMinNs, Config.WideWindowMaxNs);
+  TString Selection = CombineCutsAND(BaseCuts, WideGate);
+  std::set<std::string> CutBranches;
+  T->SetBranchStatus("*", 1);
+  if (!BranchesForExpressions(T, {Selection}, CutBranches)) return false;
+  T->SetBranchStatus("*", 0);
+  for (const auto& C : Skim.Columns) T->SetBranchStatus(C, 1);
+  for (const auto& N : CutBranches)  T->SetBranchStatus(N.c_str(), 1);
+
+  // Written to a temporary file (unique per writer) and renamed, so a half-written skim is never
+  // read; the temporary file is removed if anything fails
+  gSystem->mkdir(Skim.Dir.c_str(), true);
+  const std::string Tmp = Path + CacheTmpSuffix();
+  auto Fail = [&Tmp](const TString& Msg) { std::cerr << "[WARN] Skim: " << Msg << "\n"; gSystem->Unlink(Tmp.c_str()); return false; };
+  std::unique_ptr<TFile> Out(TFile::Open(Tmp.c_str(), "RECREATE"));
+  if (!Out || Out->IsZombie()) { Out.reset(); return Fail("could not create " + TString(Tmp)); }
+  Out->cd();
+  TTree* S = T->CopyTree(Selection); // copies only the enabled branches
+  if (!S) { Out.reset(); return Fail(TString::Format("CopyTree failed for run %d", Run)); }
+  S->Write();
+  TNamed("SkimCuts", BaseCuts.Data()).Write();
+  TNamed("SkimKey", Key.Data()).Write();
+  std::cout << "Skim run " << Run << ": " << S->GetEntries() << " of " << T->GetEntries() << " events\n";
+  Out->Close();
+  if (gSystem->Rename(Tmp.c_str(), Path.c_str()) != 0) return Fail("could not rename " + TString(Tmp) + " to " + Path.c_str());
+  return true;
+}
+
+// Open the tree to project Cuts from: the run's skim when it is fresh for these cuts, the
+// replay file otherwise. File owns the opened file; nullptr if no tree could be opened.
+inline TTree* OpenRunTree(int Run, const std::string& SrcPath, const TString& Cuts,
+                          const CoincidenceConfig& Config, std::unique_ptr<TFile>& File,
+                          const SkimConfig& Skim = SkimConfig())
+{
+  const std::string Path = SkimPath(Run, Skim);
+  if (!gSystem->AccessPathName(Path.c_str())) {
+    File.reset(TFile::Open(Path.c_str(), "READ"));
+    TString SkimCuts, Key;
+    if (File && !File->IsZombie() && ReadSkimInfo(File.get(), SkimCuts, Key) &&
+        SkimCovers(SkimCuts, Cuts) && Key == SkimKey(SrcPath, SkimCuts, Config, Skim)) {
+      if (TTree* T = (TTree*)File->Get("T")) return T;
+    }
+  }
+
+  File.reset(TFile::Open(SrcPath.c_str(), "READ"));
+  if (!File || File->IsZombie()) { std::cerr << "[WARN] Could not open " << SrcPath << "\n"; return nullptr; }
+  TTree* T = (TTree*)File->Get("T");
+  if (!T) std::cerr << "[WARN] Tree 'T' missing in " << SrcPath << "\n";
+  return T;
+}
+
+#endif // SKIM_CACHE_H
@@ -0,0 +1,139 @@
+// SystematicVariations.h
+// Random-subtracted yields of one variable for many systematic variations (CoincidenceConfig
+// and cuts) from ONE read of the tree, instead of one macro run per variation.
+//
+// Every event is tested once against each distinct cut of the set and each variation's wide CT
+// gate; the result is a bitmask (bit v: the event counts for variation v). Variations with the
+// same cuts, wide gate and CT binning share one CT histogram; each variation then gets its own
+// peak/windows (FindCoincidenceWindows with its config) and its own output histogram, filled
+// by the same accumulator as the single-pass engine. So output v is bit-identical to
+//   FillRandomSubtractedHistogram(Tree, Variations[v].Cuts, Var, Outputs[v], Variations[v].Config)
+#ifndef SYSTEMATIC_VARIATIONS_H
+#define SYSTEMATIC_VARIATIONS_H
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "TH1.h"
+#include "TH1D.h"
+#include "TTree.h"
+#include "TEntryList.h"
+#include "TString.h"
+#include "CompiledCuts.h"
+#include "CoincidenceRandomSubtraction.h"
+
+// One variation: its name, its full base cuts and its CT configuration
+struct SystematicVariation {
+  TString           Name;
+  TypedCut          Cuts;
+  CoincidenceConfig Config;
+};
+
+// Fills Outputs[v] (pre-booked, reset here) with the random-subtracted VarExpression of
+// variation v; returns the CoincidenceResult of each variation, in order. At most 32
+// variations per call; all of them must read the same CT branch.
+inline std::vector<CoincidenceResult> FillSystematicVariations(
+    TTree* Tree,
+    const std::vector<SystematicVariation>& Variations,
+    const char* VarExpression,
+    const std::vector<TH1*>& Outputs)
+{
+  const size_t NVar = Variations.size();
+  std::vector<CoincidenceResult> Results(NVar);
+  if (!Tree || NVar == 0 || Outputs.size() != NVar) return Results;
+  if (NVar > 32) { std::cerr << "[ERROR] Too many variations (" << NVar << ", max 32)\n"; return Results; }
+  for (const auto& V : Variations) {
+    if (V.Config.CtBranchName != Variations[0].Config.CtBranchName) {
+      std::cerr << "[ERROR] Variation " << V.Name << " reads another CT branch (" << V.Config.CtBranchName << ")\n";
+      return Results;
+    }
+  }
+  for (TH1* H : Outputs) { H->Reset(); EnsureSumw2(H); }
+
+  // Distinct cuts (bound once) and distinct CT histograms (cuts + wide gate + binning)
+  std::vector<TypedCut> Cuts;
+  std::vector<int> CutOf(NVar), HctOf(NVar);
+  std::vector<TString> HctKeys;
+  for (size_t v=0; v<NVar; ++v) {
+    const SystematicVariation& V = Variations[v];
+    int c = 0;
+    while (c < int(Cuts.size()) && Cuts[c].Title() != V.Cuts.Title()) ++c;
+    if (c == int(Cuts.size())) Cuts.push_back(V.Cuts);
+    CutOf[v] = c;
+    TString Key = TString::Format("%d|%.17g|%.17g|%d", c, V.Config.WideWindowMinNs, V.Config.WideWindowMaxNs,
+                                  V.Config.CtHistogramNBins);
+    int h = 0;
+    while (h < int(HctKeys.size()) && HctKeys[h] != Key) ++h;
+    if (h == int(HctKeys.size())) HctKeys.push_back(Key);
+    HctOf[v] = h;
+  }
+
+  BoundBranches Branches(Tree);
+  std::vector<TypedCut::Predicate> Pass(Cuts.size());
+  for (size_t c=0; c<Cuts.size(); ++c) Pass[c] = Cuts[c].Bind(Branches);
+  ValueReader ReadCt  = BindValue(Branches, Variations[0].Config.CtBranchName);
+  ValueReader ReadVar = BindValue(Branches, VarExpression);
+  if (!ReadCt || !ReadVar) { std::cerr << "[ERROR] Could not compile CT/variable formulas on tree " << Tree->GetName() << "\n"; return Results; }
+
+  // Wide gate of each variation, compared like BuildRangeCut does
+  std::vector<std::pair<double,double>> Wide(NVar);
+  for (size_t v=0; v<NVar; ++v)
+    Wide[v] = {RangeCutEdge(Variations[v].Config.WideWindowMinNs), RangeCutEdge(Variations[v].Config.WideWindowMaxNs)};
+
+  std::vector<std::unique_ptr<TH1D>> Hct(HctKeys.size());
+  for (size_t v=0; v<NVar; ++v) {
+    if (Hct[HctOf[v]]) continue;
+    const CoincidenceConfig& C = Variations[v].Config;
+    Hct[HctOf[v]].reset(new TH1D(Form("Hct_var%zu", v), ";Coincidence time (ns);Counts",
+                                 C.CtHistogramNBins, C.WideWindowMinNs, C.WideWindowMaxNs));
+    Hct[HctOf[v]]->SetDirectory(nullptr);
+    EnsureSumw2(Hct[HctOf[v]].get());
+  }
+
+  // The only pass over the tree: buffer CT, value and mask of every event any variation keeps
+  std::vector<double>   BufCt, BufVal;
+  std::vector<unsigned> BufMask;
+  std::vector<char>     CutPass(Cuts.size());
+  const Long64_t NToRead = Tree->GetEntryList() ? Tree->GetEntryList()->GetN() : Tree->GetEntries();
+  for (Long64_t i=0; i<NToRead; ++i) {
+    Long64_t Entry = Tree->GetEntryNumber(i);
+    if (Entry < 0 || !Branches.GetEntry(Entry)) break;
+
+    double Ct = 0.0;
+    if (!ReadCt(Ct)) continue;
+    for (size_t c=0; c<Cuts.size(); ++c) CutPass[c] = Pass[c]();
+    unsigned Mask = 0;
+    for (size_t v=0; v<NVar; ++v)
+      if (CutPass[CutOf[v]] && Ct > Wide[v].first && Ct < Wide[v].second) Mask |= (1u << v);
+    if (Mask == 0) continue;
+
+    // CT histograms: once per shared histogram
+    unsigned HctDone = 0;
+    for (size_t v=0; v<NVar; ++v) {
+      if (!(Mask & (1u << v)) || (HctDone & (1u << HctOf[v]))) continue;
+      Hct[HctOf[v]]->Fill(Ct);
+      HctDone |= (1u << HctOf[v]);
+    }
+
+    double Val = 0.0;
+    if (!ReadVar(Val)) continue;
+    BufCt.push_back(Ct);
+    BufVal.push_back(Val);
+    BufMask.push_back(Mask);
+  }
+
+  // Peak and windows per variation, then split the buffer (one output per variation = group)
+  std::vector<RandomSubtractionOutput> Out(NVar);
+  for (size_t v=0; v<NVar; ++v) {
+    Results[v] = FindCoincidenceWindows(Hct[HctOf[v]].get(), Variations[v].Config);
+    Out[v].Group = int(v);
+    Out[v].Hist  = Outputs[v];
+  }
+  RandomSubtractionAccumulator Acc(Out, Results);
+  std::vector<char> HasVal(NVar, 1);
+  for (size_t e=0; e<BufCt.size(); ++e) Acc.Add(BufCt[e], BufMask[e], HasVal.data(), &BufVal[e]);
+  Acc.Finish();
+  return Results;
+}
+
+#endif // SYSTEMATIC_VARIATIONS_H
@@ -0,0 +1,80 @@
+// rp_datavssim.cxx
+// Command-line driver of libRPAnalysis.so (make; see Makefile):
+//   ./rp_datavssim -c datavssim.conf [-j threads]        run the analysis with a config file
+//   ./rp_datavssim --print-config [-c file]              print the settings in config format
+//   ./rp_datavssim --render FILE [var,var,...] [-j n]    render stage only (ComparisonPlotFile.h)
+// Sharded execution (RunShards.h; shard files in --shard-dir, default ./SHARDS):
+//   ./rp_datavssim -c cfg --shards N [-P procs]          N shards in local worker processes, then the merge
+//   ./rp_datavssim -c cfg --shard K/N                    shard K only (e.g. one cluster job per shard)
+//   ./rp_datavssim -c cfg --merge N                      merge the N shard files and plot
+// Follow mode (LiveFollow.h), while hcana is still writing the run's replay file:
+//   ./rp_datavssim -c cfg --follow RUN [--poll S] [--idle-polls N]   redraw every S seconds (default 60)
+//                                                                    until the file stops growing
+// Without -c the built-in defaults of DataVsSimConfig.h are used.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TROOT.h"
+#include "DataVsSimConfig.h"
+#include "ComparisonPlotFile.h"
+#include "RunShards.h"
+
+static void Usage(const char* Prog) {
+  std::cerr << "Usage: " << Prog << " [-c config] [-j threads] [--print-config]\n"
+            << "       " << Prog << " [-c config] [-j threads] (--shards N [-P procs] | --shard K/N | --merge N) [--shard-dir DIR]\n"
+            << "       " << Prog << " [-c config] [-j threads] --follow RUN [--poll seconds] [--idle-polls N]\n"
+            << "       " << Prog << " --render FILE [var,var,...] [-j workers]\n";
+}
+
+int main(int argc, char** argv) {
+  std::string ConfigFile, RenderFile, RenderVars, ShardDir = DefaultRunShardDir();
+  int Threads = -1, Shards = 0, Procs = 0, Shard = -1, MergeShards = 0;
+  int FollowRun = 0, PollSeconds = 60, IdlePolls = 10;
+  bool PrintConfig = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string A = argv[i];
+    if ((A == "-c" || A == "--config") && i + 1 < argc)  ConfigFile = argv[++i];
+    else if ((A == "-j" || A == "--threads") && i + 1 < argc) Threads = std::atoi(argv[++i]);
+    else if (A == "--print-config")                     PrintConfig = true;
+    else if (A == "--shards" && i + 1 < argc)             Shards = std::atoi(argv[++i]);
+    else if (A == "-P" && i + 1 < argc)                   Procs = std::atoi(argv[++i]);
+    else if (A == "--merge" && i + 1 < argc)              MergeShards = std::atoi(argv[++i]);
+    else if (A == "--shard-dir" && i + 1 < argc)          ShardDir = argv[++i];
+    else if (A == "--follow" && i + 1 < argc)             FollowRun = std::atoi(argv[++i]);
+    else if (A == "--poll" && i + 1 < argc)               PollSeconds = std::atoi(argv[++i]);
+    else if (A == "--idle-polls" && i + 1 < argc)         IdlePolls = std::atoi(argv[++i]);
+    else if (A == "--shard" && i + 1 < argc) {
+      if (std::sscanf(argv[++i], "%d/%d", &Shard, &Shards) != 2 || Shard < 0 || Shard >= Shards) { Usage(argv[0]); return 2; }
+    }
+    else if (A == "--render" && i + 1 < argc) {
+      RenderFile = argv[++i];
+      if (i + 1 < argc && argv[i + 1][0] != '-') RenderVars = argv[++i];
+    }
+    else if (A == "-h" || A == "--help") { Usage(argv[0]); return 0; }
+    else { Usage(argv[0]); return 2; }
+  }
+
+  gROOT->SetBatch(kTRUE);
+
+  if (!RenderFile.empty()) {
+    const int NWorkers = (Threads > 0) ? Threads : std::max(1, (int)std::thread::hardware_concurrency());
+    return RenderComparisonPlots(RenderFile, NWorkers, SplitConfigList(RenderVars)) == 0 ? 0 : 1;
+  }
+
+  DataVsSimSettings Settings;
+  if (!ConfigFile.empty() && !LoadDataVsSimSettings(ConfigFile, Settings)) return 1;
+  if (Threads >= 0) Settings.Threads = Threads;
+  if (PrintConfig) { WriteDataVsSimSettings(std::cout, Settings); return 0; }
+
+  if (FollowRun > 0)    return FollowDataVsSimRun(Settings, FollowRun, PollSeconds, IdlePolls) ? 0 : 1;
+  if (Shard >= 0)       return RunDataVsSimShard(Settings, Shard, Shards, ShardDir) ? 0 : 1;
+  if (MergeShards > 0)  return MergeDataVsSimShards(Settings, MergeShards, ShardDir) ? 0 : 1;
+  if (Shards > 0)       return RunDataVsSimSharded(Settings, Shards, Procs, ShardDir) ? 0 : 1;
+
+  RunDataVsSimPlot(Settings);
+  return 0;
+}
@@ -9,12 +9,14 @@
 #include <TSystem.h>
 #include <TROOT.h>
 #include <iostream>
+#include <memory>
 #include <string>
 
 
 // Plotting function
-// Use h1 and h2 as hSim and hDataSubDummy respectively
-void PlotComparisonAndRatio(TH1D* h1, TH1D* h2, std::string varName) {
+// Use h1 and h2 as hSim and hDataSubDummy respectively. The canvas, legend, ratio histogram and
+// line are deleted on return (the plot is in the PDF); the histograms stay with the caller.
+inline void PlotComparisonAndRatio(TH1D* h1, TH1D* h2, std::string varName) {
 
     // Find the max values from both histograms
     double max1 = h1 -> GetMaximum();
@@ -24,7 +26,7 @@ void PlotComparisonAndRatio(TH1D* h1, TH1D* h2, std::string varName) {
     double ymax = std::max(max1, max2) * 1.1;
 
     //Draw the canvas
-    TCanvas* c1 = new TCanvas(Form("c_%s", varName.c_str()), Form("Simulation vs Data: %s", varName.c_str()), 900, 700);
+    std::unique_ptr<TCanvas> c1(new TCanvas(Form("c_%s", varName.c_str()), Form("Simulation vs Data: %s", varName.c_str()), 900, 700));
     c1->Divide(1, 2);
 
     // Upper pad: comparison plot
@@ -57,7 +59,7 @@ void PlotComparisonAndRatio(TH1D* h1, TH1D* h2, std::string varName) {
     h2->Draw("HIST SAME");
 
     // Legend
-    auto leg = new TLegend();
+    std::unique_ptr<TLegend> leg(new TLegend());
     // Dynamic positioning of legend box
     int maxBin = h1->GetMaximumBin();
     double maxX = h1->GetXaxis()->GetBinCenter(maxBin);
@@ -91,7 +93,8 @@ void PlotComparisonAndRatio(TH1D* h1, TH1D* h2, std::string varName) {
     pad_d->cd();
 
     // Make ratio histogram
-    TH1D* hRatio = (TH1D*) h1 -> Clone("hRatio"); // clone to avoid modifying original
+    std::unique_ptr<TH1D> hRatio((TH1D*) h1 -> Clone(Form("hRatio_%s", varName.c_str()))); // clone to avoid modifying original
+    hRatio->SetDirectory(nullptr);
     hRatio->Divide(h2); // Sim / (Data - Dummy)
 
     hRatio->SetLineColor(kBlack);
@@ -125,7 +128,7 @@ void PlotComparisonAndRatio(TH1D* h1, TH1D* h2, std::string varName) {
     gPad->RedrawAxis();
 
     // Draw a dashed line at y=1
-    TLine* line = new TLine(hRatio->GetXaxis()->GetXmin(), 1.0, hRatio->GetXaxis()->GetXmax(), 1.0);
+    std::unique_ptr<TLine> line(new TLine(hRatio->GetXaxis()->GetXmin(), 1.0, hRatio->GetXaxis()->GetXmax(), 1.0));
     line->SetLineStyle(2);
     line->Draw();
 
@@ -134,11 +137,15 @@ void PlotComparisonAndRatio(TH1D* h1, TH1D* h2, std::string varName) {
     /*c1->Update();
     gSystem->ProcessEvents();
     std::cout << "Close the canvas to continue...\n";
-    while (gROOT->GetListOfCanvases()->FindObject(c1)) {
+    while (gROOT->GetListOfCanvases()->FindObject(c1.get())) {
         gSystem->ProcessEvents();
         gSystem->Sleep(100);
     }*/
 
+    // Primitives go before the canvas that lists them
+    line.reset();
+    leg.reset();
+    c1.reset();
 }
 
 #endif // PLOT_COMPARISON_AND_RATIO_H